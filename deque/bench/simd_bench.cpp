@@ -0,0 +1,91 @@
+// deque find/count/min/max/sum against the same scans written as
+// iterator loops, 10M elements of each type by default.
+//   g++ -std=c++17 -O2 -DNDEBUG -I.. simd_bench.cpp -o simd_bench
+//   ./simd_bench [elements] [rounds]
+#include "deque.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+static double seconds_since(std::chrono::steady_clock::time_point t) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+}
+
+static void report(const char *type, const char *name, double s, size_t elements, double check) {
+    printf("%-10s %-12s %8.3f s  %6.3f ns/element  (%g)\n", type, name, s, s * 1e9 / elements, check);
+}
+
+// time rounds calls of f and report them. what f returns is summed, and
+// memory is clobbered between rounds, so that no scan is dropped or
+// hoisted out of the loop.
+template <class F>
+static void run(const char *type, const char *name, size_t rounds, size_t n, F f) {
+    double check = 0;
+    auto t = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < rounds; ++r) {
+        check += (double)f();
+        __asm__ __volatile__("" ::: "memory");
+    }
+    report(type, name, seconds_since(t), n * rounds, check);
+}
+
+template <class Tp>
+static void bench(const char *type, size_t n, size_t rounds) {
+    std::mt19937 rng(1);
+    sjtu::deque<Tp> d;
+    for (size_t i = 0; i < n; ++i) d.push_back((Tp)(rng() % 1000000));
+    // not in d, so find scans everything.
+    const Tp missing = (Tp)-1;
+
+    run(type, "find", rounds, n, [&] { return d.find(missing) == d.end(); });
+    run(type, "find loop", rounds, n, [&] {
+        auto it = d.begin();
+        while (it != d.end() && !(*it == missing)) ++it;
+        return it == d.end();
+    });
+
+    run(type, "count", rounds, n, [&] { return d.count(d.back()); });
+    run(type, "count loop", rounds, n, [&] {
+        size_t c = 0;
+        Tp v = d.back();
+        for (auto it = d.begin(); it != d.end(); ++it) c += *it == v;
+        return c;
+    });
+
+    run(type, "min", rounds, n, [&] { return d.min(); });
+    run(type, "min loop", rounds, n, [&] {
+        Tp lo = d.front();
+        for (auto it = d.begin(); it != d.end(); ++it) if (*it < lo) lo = *it;
+        return lo;
+    });
+
+    run(type, "max", rounds, n, [&] { return d.max(); });
+    run(type, "max loop", rounds, n, [&] {
+        Tp hi = d.front();
+        for (auto it = d.begin(); it != d.end(); ++it) if (hi < *it) hi = *it;
+        return hi;
+    });
+
+    run(type, "sum", rounds, n, [&] { return d.sum(); });
+    run(type, "sum loop", rounds, n, [&] {
+        typename sjtu::simd::sum_type<Tp>::type s = 0;
+        for (auto it = d.begin(); it != d.end(); ++it) s += *it;
+        return s;
+    });
+}
+
+int main(int argc, char **argv) {
+    size_t n = argc > 1 ? strtoull(argv[1], nullptr, 10) : 10000000;
+    size_t rounds = argc > 2 ? strtoull(argv[2], nullptr, 10) : 20;
+#ifdef SJTU_SIMD_X86
+    printf("%zu elements, %zu rounds, %s\n", n, rounds, sjtu::simd::has_avx2() ? "avx2" : "sse2");
+#else
+    printf("%zu elements, %zu rounds, scalar\n", n, rounds);
+#endif
+    bench<int>("int", n, rounds);
+    bench<long long>("long long", n, rounds);
+    bench<float>("float", n, rounds);
+    bench<double>("double", n, rounds);
+    return 0;
+}
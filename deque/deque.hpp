@@ -1,6 +1,9 @@
 #include "utility.hpp"
 #include "exceptions.hpp"
+#include "simd.hpp"
 #include <cstring>
+#include <memory>
+#include <new>
 #include <utility>
 #include <cstdio>
 #include <limits>
@@ -9,6 +12,13 @@
 
 #ifndef SJTU_DEQUE
 #define SJTU_DEQUE
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define SJTU_HAS_PMR
+#endif
+#endif
   
 namespace sjtu {
 
@@ -20,9 +30,12 @@ namespace sjtu {
     }
 
     // using block list to implement the deque.
-    template<class Tp>
+    // blocks, element arrays and elements go through Allocator.
+    template<class Tp, class Allocator = std::allocator<Tp>>
     class deque {
     public:
+        using allocator_type = Allocator;
+
 #ifndef DEBUG
         static constexpr size_t max_size = 1024;
         static constexpr size_t half = 512;
@@ -41,123 +54,91 @@ namespace sjtu {
         friend class iterator;
         friend class const_iterator;
 
-        struct T {
-            Tp *v;
-            T(): v(nullptr) {}
-            T(const Tp& v): v(new Tp(v)) {}
-            Tp& operator()() const {
-                return v;
-            }
-            T& operator = (const Tp& other) {
-                if (!v) {
-                    v = new Tp(other);
-                } else {
-                    *v = other;
-                }
-                return *this;
-            }
-            T& operator = (const T& other) {
-                if (v) {
-                    *v = *(other.v);
-                } else {
-                    v = new Tp(*(other.v));
-                }
-                return *this;
-            }
-            ~T() {
-                if (v) delete v;
-            }
-        };
-
-        
+        using alloc_traits = std::allocator_traits<Allocator>;
 
         // the block of the blockList.
+        // elements live inline in data[start, end), the rest is raw storage.
         struct Block {
-            T* data;
+            Tp* data;
             size_t start, end;
             Block *prev, *next;
+            Allocator *alloc;
+
+            Tp* allocate() {
+                return alloc_traits::allocate(*alloc, max_size);
+            }
+
+            template <class... Args>
+            void construct(size_t i, Args&&... args) {
+                alloc_traits::construct(*alloc, data + i, std::forward<Args>(args)...);
+            }
+
+            void destroy(size_t i) {
+                alloc_traits::destroy(*alloc, data + i);
+            }
 
-            Block(Block *next) {
-                data = new T[max_size];
+            Block(Allocator *alloc, Block *next): alloc(alloc) {
+                data = allocate();
                 this->prev = nullptr;
                 this->next = next;
                 start = init_position;
                 end = init_position;
             }
 
-            Block() {
+            Block(): alloc(nullptr) {
                 data = nullptr;
                 prev = next = nullptr;
                 start = end = init_position;
             }
 
-            Block(const Block& other) {
-                if (this != &other) {
-                    start = other.start;
-                    end = other.end;
-                    data = new T[max_size];
-                    for (int i = start; i < end; ++i) {
-                        data[i] = other.data[i];
-                    }
-                    prev = next = nullptr;
-                }
-            }
-
-            Block& operator = (const Block& other) {
-                // DO NOT copy prev, next here.
-                // this will be handled outside the class Block.
-                data = new T[max_size];
+            Block(Allocator *alloc, const Block& other): alloc(alloc) {
                 start = other.start;
                 end = other.end;
-                for (int i = start; i < end; ++i) {
-                    data[i] = other.data[i];
+                data = allocate();
+                for (size_t i = start; i < end; ++i) {
+                    construct(i, other.data[i]);
                 }
-                return *this;
+                prev = next = nullptr;
             }
 
-            Block& operator = (Block &&other) {
-                if (this != &other) {
-                    data = other.data;
-                    start = other.start;
-                    end = other.end;
-                    other.data = nullptr;
-                }
-                return *this;
-            }
+            // DO NOT copy a block by assignment.
+            // prev and next are handled outside the class Block.
+            Block& operator = (const Block& other) = delete;
 
             ~Block() {
                 if (data) {
-                    delete []data;
+                    clear();
+                    alloc_traits::deallocate(*alloc, data, max_size);
                 }
             }
 
-            Block(Block* other, size_t st, size_t ed): prev(nullptr), next(nullptr) {
+            Block(Allocator *alloc, Block* other, size_t st, size_t ed): prev(nullptr), next(nullptr), alloc(alloc) {
                 // move other blocks' data from st to ed to the new block.
                 // mainly for split blocks.
 
-                data = new T[max_size];
+                data = allocate();
                 start = init_position;
                 end = init_position + (ed - st);
-                for (int i = st; i < ed; ++i) {
+                for (size_t i = st; i < ed; ++i) {
 #ifdef DEBUG
-                    printf("odt[%d]: %d\n", i, other->data[i]);
+                    printf("odt[%d]: %d\n", (int)i, other->data[i]);
 #endif
                     
-                    data[init_position - st + i] = other->data[i];
+                    construct(init_position - st + i, std::move(other->data[i]));
                 }
             }
 
-            Block(Block* left, Block* right) {
+            Block(Allocator *alloc, Block* left, Block* right): alloc(alloc) {
                 //merge left and right.
-                data = new T[max_size];
+                data = allocate();
                 size_t szl = left->size(), szr = right->size();
                 start = init_position;
                 end = init_position + szl + szr;
-                for (int i = left->start; i < left->end; ++i) {
-                    data[i - left->start + start] = left->data[i];
+                for (size_t i = left->start; i < left->end; ++i) {
+                    construct(i - left->start + start, std::move(left->data[i]));
                 }
-                for (int i = right->start; i < right->end; ++i) {
-                    data[i - right->start + szl + start] = right->data[i];
+                for (size_t i = right->start; i < right->end; ++i) {
+                    construct(i - right->start + szl + start, std::move(right->data[i]));
                 }
                 prev = next = nullptr;
             }
@@ -171,37 +152,49 @@ namespace sjtu {
             }
 
             Tp& get(size_t k) const {
-                return *(data[start + k].v);
+                return data[start + k];
+            }
+
+            void clear() {
+                for (size_t i = start; i < end; ++i) {
+                    destroy(i);
+                }
+                start = end = init_position;
             }
 
             void move_forward(size_t x) {
-                for (int i = end + x - 1; i >= start + x; --i) {
-                    data[i] = data[i - x];
+                for (size_t i = end; i-- > start; ) {
+                    construct(i + x, std::move(data[i]));
+                    destroy(i);
                 }
                 start += x;
                 end += x;
             }
 
             void move_backward(size_t x) {
-                for (int i = start - x; i < end - x; ++i) {
-                    data[i] = data[i + x];
+                for (size_t i = start; i < end; ++i) {
+                    construct(i - x, std::move(data[i]));
+                    destroy(i);
                 }
                 start -= x;
                 end -= x;
             }
 
-            void insert_to(const T&x, size_t pos) {
+            void insert_to(const Tp&x, size_t pos) {
                 pos += start;
-                if (pos == start) {
-                    data[--start] = x;
+                if (pos == start && start > 0) {
+                    construct(start - 1, x);
+                    --start;
                 }
                 else if (pos == end) {
-                    data[end++] = x;
+                    construct(end, x);
+                    ++end;
                 }
                 else {
+                    construct(end, std::move(data[end - 1]));
                     end++;
-                    for (int i = end - 1; i > pos; --i) {
-                        data[i] = data[i-1];
+                    for (size_t i = end - 2; i > pos; --i) {
+                        data[i] = std::move(data[i-1]);
                     }
                     data[pos] = x;
                 }
@@ -210,23 +203,18 @@ namespace sjtu {
             void remove(size_t pos) {
                 pos += start;
                 if (pos == start) {
-                    delete data[start].v;
-                    data[start].v = nullptr;
+                    destroy(start);
                     ++start;
                 }
                 else if (pos == end-1) {
                     --end;
-                    delete data[end].v;
-                    data[end].v = nullptr;
+                    destroy(end);
                 }
                 else {
-                    swap(data[pos].v, data[end-1].v);
-                    swap(*(data[pos].v), *(data[end-1].v));
-                    for (int i = pos; i < end - 1; ++i) {
-                        data[i] = data[i+1];
+                    for (size_t i = pos; i < end - 1; ++i) {
+                        data[i] = std::move(data[i+1]);
                     }
-                    delete data[end-1].v;
-                    data[end-1].v = nullptr;
+                    destroy(end - 1);
                     --end;
                 }
             }
@@ -235,14 +223,110 @@ namespace sjtu {
 
         size_t total_size;
         size_t n_blocks;
+        Allocator alloc;
+
+        using block_allocator = typename alloc_traits::template rebind_alloc<Block>;
+        using block_traits = std::allocator_traits<block_allocator>;
+
+        template <class... Args>
+        Block* alloc_block(Args&&... args) {
+            block_allocator a(alloc);
+            Block *p = block_traits::allocate(a, 1);
+            try {
+                new (p) Block(std::forward<Args>(args)...);
+            } catch (...) {
+                block_traits::deallocate(a, p, 1);
+                throw;
+            }
+            return p;
+        }
+
+        void free_block(Block *p) {
+            block_allocator a(alloc);
+            p->~Block();
+            block_traits::deallocate(a, p, 1);
+        }
+
+        // cursor cache for positional access: the block last located by
+        // locate() and the index of its first element in the whole deque.
+        // it is updated from const members as well, so concurrent readers
+        // of one deque must not share it.
+        mutable Block *finger;
+        mutable size_t finger_base;
+
+        // empty blocks kept by reserve_front() and reserve_back(),
+        // linked by next. they are taken before allocating a new block.
+        Block *spare_front, *spare_back;
+        size_t n_spare_front, n_spare_back;
+
+        Block* take_block(Block *&from, size_t &n_from, Block *&other, size_t &n_other) {
+            Block *p;
+            if (from) {
+                p = from;
+                from = p->next;
+                --n_from;
+            } else if (other) {
+                p = other;
+                other = p->next;
+                --n_other;
+            } else {
+                p = alloc_block(&alloc, nullptr);
+            }
+            p->prev = p->next = nullptr;
+            return p;
+        }
+
+        Block* link_back() {
+            // append an empty block before tail, filled from its beginning.
+            Block *p = take_block(spare_back, n_spare_back, spare_front, n_spare_front);
+            p->start = p->end = 0;
+            p->prev = tail->prev;
+            p->next = tail;
+            tail->prev->next = p;
+            tail->prev = p;
+            ++n_blocks;
+            return p;
+        }
+
+        Block* link_front() {
+            // prepend an empty block to head, filled from its end.
+            Block *p = take_block(spare_front, n_spare_front, spare_back, n_spare_back);
+            p->start = p->end = max_size;
+            p->next = head;
+            head->prev = p;
+            head = p;
+            ++n_blocks;
+            return p;
+        }
+
+        void reserve_spare(Block *&list, size_t &n_list, size_t room, size_t n) {
+            if (n <= room) {
+                return;
+            }
+            size_t need = (n - room + max_size - 1) / max_size;
+            while (n_list < need) {
+                Block *p = alloc_block(&alloc, list);
+                list = p;
+                ++n_list;
+            }
+        }
+
+        void free_spare(Block *&list, size_t &n_list) {
+            while (list) {
+                Block *p = list->next;
+                free_block(list);
+                list = p;
+            }
+            n_list = 0;
+        }
 
         Block* split_block(Block* x) {
             // split x into l and r.
             // return the new block l.
             n_blocks++;
             size_t middle = x->start + (x->end - x->start) / 2;
-            Block *new_left = new Block(x, x->start, middle);
-            Block *new_right = new Block(x, middle, x->end);
+            Block *new_left = alloc_block(&alloc, x, x->start, middle);
+            Block *new_right = alloc_block(&alloc, x, middle, x->end);
             new_left->next = new_right;
             new_right->prev = new_left;
 
@@ -258,7 +342,11 @@ namespace sjtu {
             if (head == x) {
                 head = new_left;
             }
-            delete x;
+            if (finger == x) {
+                // new_left starts where x started.
+                finger = new_left;
+            }
+            free_block(x);
             return new_left;
         }
 
@@ -266,7 +354,7 @@ namespace sjtu {
             //merge the block l and block r.
             //return the new block.
             --n_blocks;
-            Block *new_block = new Block(l, r);
+            Block *new_block = alloc_block(&alloc, l, r);
             new_block->prev = l->prev;
             if (l->prev) l->prev->next = new_block;
             new_block->next = r->next;
@@ -274,44 +362,69 @@ namespace sjtu {
             if (head == l) {
                 head = new_block;
             }
-            delete l;
-            delete r;
+            if (finger == l) {
+                finger = new_block;
+            } else if (finger == r) {
+                finger = new_block;
+                finger_base -= l->size();
+            }
+            free_block(l);
+            free_block(r);
             return new_block;
         }
 
-        Tp& access(size_t k) const {
-            auto p = head;
-            while (k >= p->size()) {
-                k -= p->size();
+        Block* locate(size_t& pos, bool le) const {
+            // find the block of pos and turn pos into the offset inside it.
+            // le: stop at the block with pos < size (the element itself),
+            // otherwise at the first block with pos <= size (insert position).
+            // the walk starts from whichever of head, finger and tail is
+            // the nearest, and goes in both directions.
+            Block *p = head;
+            size_t base = 0, dist = pos;
+            if (finger) {
+                size_t d = pos > finger_base ? pos - finger_base : finger_base - pos;
+                if (d < dist) {
+                    p = finger;
+                    base = finger_base;
+                    dist = d;
+                }
+            }
+            if (pos <= total_size && total_size - pos < dist) {
+                p = tail;
+                base = total_size;
+            }
+            while (p->prev && (le ? pos < base : pos <= base)) {
+                p = p->prev;
+                base -= p->size();
+            }
+            while (p != tail && (le ? pos >= base + p->size() : pos > base + p->size())) {
+                base += p->size();
                 p = p->next;
             }
-            return p->get(k);
+            if (p != tail) {
+                finger = p;
+                finger_base = base;
+            }
+            pos -= base;
+            return p;
         }
 
-        Block* access_p(size_t& pos, Block *q , bool _throw = true) const {
+        Tp& access(size_t k) const {
+            return locate(k, true)->get(k);
+        }
+
+        Block* access_p(size_t& pos, bool _throw = true) const {
             if (pos > total_size && _throw) {
                 throw index_out_of_bound();
             }
-            auto p = q;
-            size_t sz;
-            while (p && pos > (sz = p->size())) {
-                pos -= sz;
-                p = p->next;
-            }
-            return p;
+            return locate(pos, false);
         }
 
-        Block* access_p_le(size_t& pos, Block *q , bool _throw = true) const {
+        Block* access_p_le(size_t& pos, bool _throw = true) const {
             if (pos > total_size && _throw) {
                 throw index_out_of_bound();
             }
-            auto p = q;
-            size_t sz;
-            while (p && pos >= (sz = p->size())) {
-                pos -= sz;
-                p = p->next;
-            }
-            return p;
+            return locate(pos, true);
         }
 
         Block* try_merge(Block* p) {
@@ -393,7 +506,10 @@ namespace sjtu {
                     p->prev->next = p->next;
                 }
                 p->next->prev = p->prev;
-                delete p;
+                if (finger == p) {
+                    finger = nullptr;
+                }
+                free_block(p);
                 if (tmp == tail) {
                     tmp = tmp->prev;
                 }
@@ -418,7 +534,10 @@ namespace sjtu {
                 }
                 offset ++;
                 p->next->prev = p->prev;
-                delete p;
+                if (finger == p) {
+                    finger = nullptr;
+                }
+                free_block(p);
                 if (tmp == tail) {
                     tmp = tmp->prev;
                     offset = tmp->size();
@@ -435,11 +554,12 @@ namespace sjtu {
                 p = tail->prev;
                 pos = tail->prev->size() - 1;
             } else {
-                p = access_p_le(pos, head);
+                p = access_p_le(pos);
             }
             --total_size;
             p->remove(pos);
-            try_remove_chunk(p);
+            // p may be deleted here, go on with the block returned.
+            p = try_remove_chunk(p);
             try_merge(p);
         }
 
@@ -451,7 +571,7 @@ namespace sjtu {
             return ret + offset;
         }
 
-        void insert_front(const T& x, Block* p) {
+        void insert_front(const Tp& x, Block* p) {
             if (p->start == 0) {
                     //left full
                 if (p->size() <= half) {
@@ -460,6 +580,13 @@ namespace sjtu {
                     // thus we move the data forward.
                     p->move_forward(init_position);
                     p->insert_to(x, 0);
+                } else if (p == head) {
+                    // growing at the front: start a new block instead of
+                    // splitting, so that nothing is moved.
+                    link_front()->insert_to(x, 0);
+                    if (finger) {
+                        ++finger_base;
+                    }
                 } else {
                     // else, we split it into two new Block.
                     Block* new_left = split_block(p);
@@ -470,12 +597,16 @@ namespace sjtu {
             }
         }
 
-        void insert_back(const T& x, Block* p) {
+        void insert_back(const Tp& x, Block* p) {
             if (p->end == max_size) {
                 //right full
                 if (p->size() <= half) {
                     p->move_backward(init_position);
                     p->insert_to(x, p->size());
+                } else if (p->next == tail) {
+                    // growing at the back: start a new block instead of
+                    // splitting, so that nothing is moved.
+                    link_back()->insert_to(x, 0);
                 } else {
                     Block *new_right = split_block(p)->next;
                     new_right->insert_to(x, new_right->size());
@@ -487,7 +618,7 @@ namespace sjtu {
 
         void __insert(const Tp& x, size_t pos) {
             // insert to the before of pos.
-            auto p = access_p(pos, head);
+            auto p = access_p(pos);
             ++total_size;
 
             if (pos == 0) {
@@ -495,7 +626,7 @@ namespace sjtu {
                 if (p != tail) {
                     insert_front(x, p);
                 } else {
-                    p = new Block(tail);
+                    p = alloc_block(&alloc, tail);
                     p->insert_to(x, 0);
                     ++n_blocks;
                     p->prev = tail->prev;
@@ -524,10 +655,11 @@ namespace sjtu {
         }
 
         void remove_from_head() {
+            finger = nullptr;
             auto p = head;
             while (p && p != tail) {
                 auto q = p->next;
-                delete p;
+                free_block(p);
                 p = q;
             }
         }
@@ -655,7 +787,7 @@ namespace sjtu {
                 if (cur->start > index || cur->end <= index) {
                     throw invalid_iterator();
                 }
-                return *(cur->data[index].v);
+                return cur->data[index];
             }
 
             bool operator==(const iterator &rhs) const {
@@ -672,7 +804,7 @@ namespace sjtu {
 
             bool operator!=(const iterator &rhs) const { return !(*this == rhs); }
             bool operator!=(const const_iterator &rhs) const { return !(*this == rhs); }
-            Tp *operator->() const noexcept { return cur->data[index].v; }
+            Tp *operator->() const noexcept { return cur->data + index; }
         };
 
         class const_iterator {
@@ -753,8 +885,8 @@ namespace sjtu {
                 return l1 - l2;
             }
             
-            const Tp &operator*() const { return *(cur->data[index].v); }
-            const Tp *operator->() const noexcept { return cur->data[index].v; }
+            const Tp &operator*() const { return cur->data[index]; }
+            const Tp *operator->() const noexcept { return cur->data + index; }
 
             bool operator==(const iterator &rhs) const {
                 return belong == rhs.belong
@@ -792,24 +924,32 @@ namespace sjtu {
             
         };
 
-        deque() {
+        deque(): deque(Allocator()) {}
+
+        explicit deque(const Allocator &a): alloc(a) {
             total_size = 0;
             n_blocks = 0;
-            tail = new Block();
-            head = new Block(tail);
+            finger = nullptr;
+            spare_front = spare_back = nullptr;
+            n_spare_front = n_spare_back = 0;
+            tail = alloc_block();
+            head = alloc_block(&alloc, tail);
             tail->prev = head;
         }
 
-        deque(const deque &other) {
-            tail = new Block();
+        deque(const deque &other): alloc(alloc_traits::select_on_container_copy_construction(other.alloc)) {
+            finger = nullptr;
+            spare_front = spare_back = nullptr;
+            n_spare_front = n_spare_back = 0;
+            tail = alloc_block();
             total_size = other.total_size;
             n_blocks = other.n_blocks;
 
-            head = new Block(*(other.head));
+            head = alloc_block(&alloc, *(other.head));
             auto q = head;
 
             for (auto p = other.head->next; p != other.tail; p = p->next) {
-                q->next = new Block(*p);
+                q->next = alloc_block(&alloc, *p);
                 q->next->prev = q;
                 q = q->next;
             }
@@ -820,7 +960,9 @@ namespace sjtu {
 
         ~deque() {
             remove_from_head();
-            delete tail;
+            free_block(tail);
+            free_spare(spare_front, n_spare_front);
+            free_spare(spare_back, n_spare_back);
 		}
 
         deque &operator=(const deque &other) {
@@ -830,12 +972,12 @@ namespace sjtu {
             n_blocks = other.n_blocks;
             total_size = other.total_size;
             if (!tail)
-                tail = new Block();
+                tail = alloc_block();
             remove_from_head();
-            head = new Block(*(other.head));
+            head = alloc_block(&alloc, *(other.head));
             auto p = head, q = other.head->next;
             while (q != other.tail) {
-                auto r = new Block(*q);
+                auto r = alloc_block(&alloc, *q);
                 p->next = r;
                 r->prev = p;
                 p = r;
@@ -860,32 +1002,47 @@ namespace sjtu {
             return access(pos);
 		}
 
+        // with SJTU_UNCHECKED defined, operator[] does not check the bound:
+        // an index out of range is undefined behaviour instead of a throw.
         Tp &operator[](const size_t &pos) {
+#ifndef SJTU_UNCHECKED
             if (pos >= total_size) {
                 throw index_out_of_bound();
             }
+#endif
             return access(pos);
 		}
 
         const Tp &operator[](const size_t &pos) const {
+#ifndef SJTU_UNCHECKED
             if (pos >= total_size) {
                 throw index_out_of_bound();
             }
+#endif
             return access(pos);
 		}
 
+        // like at(), but return nullptr instead of throwing.
+        Tp *try_at(const size_t &pos) {
+            return pos < total_size ? &access(pos) : nullptr;
+        }
+
+        const Tp *try_at(const size_t &pos) const {
+            return pos < total_size ? &access(pos) : nullptr;
+        }
+
         const Tp &front() const {
             if (head == nullptr || head->start == head->end) {
                 throw container_is_empty();
             }
-            return *(head->data[head->start].v);
+            return head->data[head->start];
 		}
 
         const Tp &back() const {
             if (head == nullptr || head->start == head->end) {
                 throw container_is_empty();
             }
-            return *(tail->prev->data[tail->prev->end - 1].v);
+            return tail->prev->data[tail->prev->end - 1];
         }
 
         iterator begin() {
@@ -908,20 +1065,100 @@ namespace sjtu {
             return total_size == 0;
 		}
 
+        allocator_type get_allocator() const {
+            return alloc;
+        }
+
         size_t size() const {
             return total_size;
 		}
 
+        // number of elements the deque can hold before it allocates
+        // a block: the free slots at both ends and the spare blocks.
+        size_t capacity() const {
+            return total_size + head->start + (max_size - tail->prev->end)
+                   + (n_spare_front + n_spare_back) * max_size;
+        }
+
+        // make the next n push_back() allocate no block and split nothing.
+        void reserve_back(size_t n) {
+            reserve_spare(spare_back, n_spare_back, max_size - tail->prev->end, n);
+        }
+
+        // make the next n push_front() allocate no block and split nothing.
+        void reserve_front(size_t n) {
+            reserve_spare(spare_front, n_spare_front, head->start, n);
+        }
+
+        // release the spare blocks kept by reserve_front() and reserve_back().
+        void shrink_to_fit() {
+            free_spare(spare_front, n_spare_front);
+            free_spare(spare_back, n_spare_back);
+        }
+
+        void resize(size_t n, const Tp &value) {
+            if (n >= total_size) {
+                // fill the last block, then whole new blocks.
+                Block *p = tail->prev;
+                while (total_size < n) {
+                    if (p->end == max_size) {
+                        p = link_back();
+                    }
+                    size_t k = n - total_size;
+                    if (k > max_size - p->end) {
+                        k = max_size - p->end;
+                    }
+                    for (size_t i = 0; i < k; ++i) {
+                        p->construct(p->end, value);
+                        ++p->end;
+                        ++total_size;
+                    }
+                }
+                return;
+            }
+            // drop whole blocks from the back.
+            while (total_size > n) {
+                Block *p = tail->prev;
+                size_t k = total_size - n;
+                if (k > (size_t)p->size()) {
+                    k = p->size();
+                }
+                for (size_t i = 0; i < k; ++i) {
+                    p->destroy(--p->end);
+                }
+                total_size -= k;
+                if (p->empty() && p != head) {
+                    p->prev->next = tail;
+                    tail->prev = p->prev;
+                    if (finger == p) {
+                        finger = nullptr;
+                    }
+                    --n_blocks;
+                    free_block(p);
+                }
+            }
+            if (total_size == 0) {
+                head->start = head->end = init_position;
+            } else {
+                try_merge(tail->prev);
+            }
+        }
+
+        void resize(size_t n) {
+            resize(n, Tp());
+        }
+
         void clear() {
             n_blocks = 0;
             total_size = 0;
+            finger = nullptr;
             auto p = head;
             while (p && p != tail) {
                 auto q = p->next;
-                delete p;
+                free_block(p);
                 p = q;
             }
-            head = new Block(tail);
+            head = alloc_block(&alloc, tail);
             tail->prev = head;
         }
 
@@ -931,6 +1168,10 @@ namespace sjtu {
             }
 
             ++total_size;
+            if (finger != pos.cur) {
+                // the offset of the finger is unknown from an iterator.
+                finger = nullptr;
+            }
             
             if (pos.cur->end == max_size) {
                 int index_saved = pos.index;
@@ -977,6 +1218,9 @@ namespace sjtu {
                 throw invalid_iterator();
             }
             --total_size;
+            if (finger != pos.cur) {
+                finger = nullptr;
+            }
             int new_index = pos.index - pos.cur->start;
             int offset = 0;
             pos.cur->remove(new_index);
@@ -994,6 +1238,75 @@ namespace sjtu {
             return iterator(this, p, new_index + p->start);
         }
 
+        // vectorized scans over the live range of every block.
+        // Tp must be arithmetic; see simd.hpp for the kernels.
+
+        iterator find(const Tp &value) {
+            static_assert(std::is_arithmetic<Tp>::value, "find() needs an arithmetic Tp");
+            for (Block *p = head; p != tail; p = p->next) {
+                size_t k = simd::find(p->data + p->start, p->size(), value);
+                if (k < (size_t)p->size()) {
+                    return iterator(this, p, p->start + k);
+                }
+            }
+            return end();
+        }
+
+        const_iterator find(const Tp &value) const {
+            static_assert(std::is_arithmetic<Tp>::value, "find() needs an arithmetic Tp");
+            for (Block *p = head; p != tail; p = p->next) {
+                size_t k = simd::find(p->data + p->start, p->size(), value);
+                if (k < (size_t)p->size()) {
+                    return const_iterator(this, p, p->start + k);
+                }
+            }
+            return cend();
+        }
+
+        size_t count(const Tp &value) const {
+            static_assert(std::is_arithmetic<Tp>::value, "count() needs an arithmetic Tp");
+            size_t ret = 0;
+            for (Block *p = head; p != tail; p = p->next) {
+                ret += simd::count(p->data + p->start, p->size(), value);
+            }
+            return ret;
+        }
+
+        Tp min() const {
+            static_assert(std::is_arithmetic<Tp>::value, "min() needs an arithmetic Tp");
+            if (total_size == 0) {
+                throw container_is_empty();
+            }
+            Tp ret = front();
+            for (Block *p = head; p != tail; p = p->next) {
+                ret = simd::min(p->data + p->start, p->size(), ret);
+            }
+            return ret;
+        }
+
+        Tp max() const {
+            static_assert(std::is_arithmetic<Tp>::value, "max() needs an arithmetic Tp");
+            if (total_size == 0) {
+                throw container_is_empty();
+            }
+            Tp ret = front();
+            for (Block *p = head; p != tail; p = p->next) {
+                ret = simd::max(p->data + p->start, p->size(), ret);
+            }
+            return ret;
+        }
+
+        // integers are summed as long long (unsigned long long), floating
+        // point numbers as Tp, in a lane-wise order.
+        typename simd::sum_type<Tp>::type sum() const {
+            static_assert(std::is_arithmetic<Tp>::value, "sum() needs an arithmetic Tp");
+            typename simd::sum_type<Tp>::type ret = 0;
+            for (Block *p = head; p != tail; p = p->next) {
+                ret += simd::sum(p->data + p->start, p->size());
+            }
+            return ret;
+        }
+
         void push_back(const Tp &value) {
             ++total_size;
             insert_back(value, tail->prev);
@@ -1013,6 +1326,13 @@ namespace sjtu {
             remove(0);
         }
     };
+
+#ifdef SJTU_HAS_PMR
+    namespace pmr {
+        template <class Tp>
+        using deque = sjtu::deque<Tp, std::pmr::polymorphic_allocator<Tp>>;
+    }
+#endif
 }
 
 #endif
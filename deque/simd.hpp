@@ -0,0 +1,562 @@
+#ifndef SJTU_SIMD_HPP
+#define SJTU_SIMD_HPP
+
+#include <cstddef>
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define SJTU_SIMD_X86
+#include <immintrin.h>
+#endif
+
+// search and aggregate kernels over a contiguous range [a, a + n).
+// int32, int64, float and double get SSE2 and AVX2 versions, the AVX2 one
+// is chosen at runtime. every other arithmetic type uses the scalar loop.
+// min/max of a range holding NaN is unspecified.
+// count_less counts the elements below v; on a sorted range that is the
+// lower bound of v.
+
+namespace sjtu {
+
+namespace simd {
+
+    template <class Tp>
+    struct sum_type {
+        using type = typename std::conditional<
+            std::is_floating_point<Tp>::value, Tp,
+            typename std::conditional<std::is_signed<Tp>::value, long long, unsigned long long>::type
+        >::type;
+    };
+
+    // 0: scalar only, 1: int32, 2: int64, 3: float, 4: double.
+    template <class Tp>
+    struct kind {
+        static constexpr int value =
+            std::is_same<Tp, float>::value ? 3 :
+            std::is_same<Tp, double>::value ? 4 :
+            !std::is_integral<Tp>::value || !std::is_signed<Tp>::value || std::is_same<Tp, bool>::value ? 0 :
+            sizeof(Tp) == 4 ? 1 :
+            sizeof(Tp) == 8 ? 2 : 0;
+    };
+
+    namespace scalar {
+
+        template <class Tp>
+        size_t find(const Tp *a, size_t n, const Tp &v) {
+            for (size_t i = 0; i < n; ++i) {
+                if (a[i] == v) return i;
+            }
+            return n;
+        }
+
+        template <class Tp>
+        size_t count(const Tp *a, size_t n, const Tp &v) {
+            size_t ret = 0;
+            for (size_t i = 0; i < n; ++i) {
+                ret += a[i] == v;
+            }
+            return ret;
+        }
+
+        template <class Tp>
+        size_t count_less(const Tp *a, size_t n, const Tp &v) {
+            size_t ret = 0;
+            for (size_t i = 0; i < n; ++i) {
+                ret += a[i] < v;
+            }
+            return ret;
+        }
+
+        template <class Tp>
+        Tp min(const Tp *a, size_t n, Tp lo) {
+            for (size_t i = 0; i < n; ++i) {
+                if (a[i] < lo) lo = a[i];
+            }
+            return lo;
+        }
+
+        template <class Tp>
+        Tp max(const Tp *a, size_t n, Tp hi) {
+            for (size_t i = 0; i < n; ++i) {
+                if (hi < a[i]) hi = a[i];
+            }
+            return hi;
+        }
+
+        template <class Tp>
+        typename sum_type<Tp>::type sum(const Tp *a, size_t n) {
+            typename sum_type<Tp>::type ret = 0;
+            for (size_t i = 0; i < n; ++i) {
+                ret += a[i];
+            }
+            return ret;
+        }
+    }
+
+#ifdef SJTU_SIMD_X86
+
+    namespace sse2 {
+
+        // ops: one register of lanes, eq() returns one mask bit per lane.
+
+        struct i32 {
+            using value_type = int;
+            using reg = __m128i;
+            struct acc { __m128i lo, hi; };
+            static constexpr size_t width = 4;
+            static reg load(const value_type *p) { return _mm_loadu_si128((const __m128i*)p); }
+            static reg set1(value_type v) { return _mm_set1_epi32(v); }
+            static int eq(reg a, reg b) { return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b))); }
+            static int lt(reg a, reg b) { return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(a, b))); }
+            static reg min(reg a, reg b) {
+                reg m = _mm_cmpgt_epi32(a, b);
+                return _mm_or_si128(_mm_and_si128(m, b), _mm_andnot_si128(m, a));
+            }
+            static reg max(reg a, reg b) {
+                reg m = _mm_cmpgt_epi32(a, b);
+                return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b));
+            }
+            static acc zero() { return acc{_mm_setzero_si128(), _mm_setzero_si128()}; }
+            static void add(acc &s, reg x) {
+                // widen to int64 with the sign words.
+                reg sign = _mm_srai_epi32(x, 31);
+                s.lo = _mm_add_epi64(s.lo, _mm_unpacklo_epi32(x, sign));
+                s.hi = _mm_add_epi64(s.hi, _mm_unpackhi_epi32(x, sign));
+            }
+            static long long reduce(const acc &s) {
+                long long t[2];
+                _mm_storeu_si128((__m128i*)t, _mm_add_epi64(s.lo, s.hi));
+                return t[0] + t[1];
+            }
+        };
+
+        struct i64 {
+            using value_type = long long;
+            using reg = __m128i;
+            using acc = __m128i;
+            static constexpr size_t width = 2;
+            static reg load(const void *p) { return _mm_loadu_si128((const __m128i*)p); }
+            static reg set1(value_type v) { return _mm_set_epi64x(v, v); }
+            static int eq(reg a, reg b) {
+                reg c = _mm_cmpeq_epi32(a, b);
+                c = _mm_and_si128(c, _mm_shuffle_epi32(c, _MM_SHUFFLE(2, 3, 0, 1)));
+                return _mm_movemask_pd(_mm_castsi128_pd(c));
+            }
+            static reg gt(reg a, reg b) {
+                // sign of b - a, corrected for overflow.
+                reg d = _mm_sub_epi64(b, a);
+                reg t = _mm_xor_si128(d, _mm_and_si128(_mm_xor_si128(a, b), _mm_xor_si128(d, b)));
+                return _mm_shuffle_epi32(_mm_srai_epi32(t, 31), _MM_SHUFFLE(3, 3, 1, 1));
+            }
+            static int lt(reg a, reg b) { return _mm_movemask_pd(_mm_castsi128_pd(gt(b, a))); }
+            static reg min(reg a, reg b) {
+                reg m = gt(a, b);
+                return _mm_or_si128(_mm_and_si128(m, b), _mm_andnot_si128(m, a));
+            }
+            static reg max(reg a, reg b) {
+                reg m = gt(a, b);
+                return _mm_or_si128(_mm_and_si128(m, a), _mm_andnot_si128(m, b));
+            }
+            static acc zero() { return _mm_setzero_si128(); }
+            static void add(acc &s, reg x) { s = _mm_add_epi64(s, x); }
+            static long long reduce(const acc &s) {
+                long long t[2];
+                _mm_storeu_si128((__m128i*)t, s);
+                return t[0] + t[1];
+            }
+        };
+
+        struct f32 {
+            using value_type = float;
+            using reg = __m128;
+            using acc = __m128;
+            static constexpr size_t width = 4;
+            static reg load(const value_type *p) { return _mm_loadu_ps(p); }
+            static reg set1(value_type v) { return _mm_set1_ps(v); }
+            static int eq(reg a, reg b) { return _mm_movemask_ps(_mm_cmpeq_ps(a, b)); }
+            static int lt(reg a, reg b) { return _mm_movemask_ps(_mm_cmplt_ps(a, b)); }
+            static reg min(reg a, reg b) { return _mm_min_ps(a, b); }
+            static reg max(reg a, reg b) { return _mm_max_ps(a, b); }
+            static acc zero() { return _mm_setzero_ps(); }
+            static void add(acc &s, reg x) { s = _mm_add_ps(s, x); }
+            static float reduce(const acc &s) {
+                float t[4];
+                _mm_storeu_ps(t, s);
+                return (t[0] + t[1]) + (t[2] + t[3]);
+            }
+        };
+
+        struct f64 {
+            using value_type = double;
+            using reg = __m128d;
+            using acc = __m128d;
+            static constexpr size_t width = 2;
+            static reg load(const value_type *p) { return _mm_loadu_pd(p); }
+            static reg set1(value_type v) { return _mm_set1_pd(v); }
+            static int eq(reg a, reg b) { return _mm_movemask_pd(_mm_cmpeq_pd(a, b)); }
+            static int lt(reg a, reg b) { return _mm_movemask_pd(_mm_cmplt_pd(a, b)); }
+            static reg min(reg a, reg b) { return _mm_min_pd(a, b); }
+            static reg max(reg a, reg b) { return _mm_max_pd(a, b); }
+            static acc zero() { return _mm_setzero_pd(); }
+            static void add(acc &s, reg x) { s = _mm_add_pd(s, x); }
+            static double reduce(const acc &s) {
+                double t[2];
+                _mm_storeu_pd(t, s);
+                return t[0] + t[1];
+            }
+        };
+
+        template <class V, class Tp>
+        size_t find(const Tp *a, size_t n, const Tp &v) {
+            using U = typename V::value_type;
+            const U *p = (const U*)a;
+            typename V::reg x = V::set1((U)v);
+            size_t i = 0;
+            for (; i + V::width <= n; i += V::width) {
+                int m = V::eq(V::load(p + i), x);
+                if (m) return i + __builtin_ctz(m);
+            }
+            return i + scalar::find(a + i, n - i, v);
+        }
+
+        template <class V, class Tp>
+        size_t count(const Tp *a, size_t n, const Tp &v) {
+            using U = typename V::value_type;
+            const U *p = (const U*)a;
+            typename V::reg x = V::set1((U)v);
+            size_t i = 0, ret = 0;
+            for (; i + V::width <= n; i += V::width) {
+                ret += __builtin_popcount(V::eq(V::load(p + i), x));
+            }
+            return ret + scalar::count(a + i, n - i, v);
+        }
+
+        template <class V, class Tp>
+        size_t count_less(const Tp *a, size_t n, const Tp &v) {
+            using U = typename V::value_type;
+            const U *p = (const U*)a;
+            typename V::reg x = V::set1((U)v);
+            size_t i = 0, ret = 0;
+            for (; i + V::width <= n; i += V::width) {
+                ret += __builtin_popcount(V::lt(V::load(p + i), x));
+            }
+            return ret + scalar::count_less(a + i, n - i, v);
+        }
+
+        template <class V, class Tp>
+        Tp min(const Tp *a, size_t n, Tp lo) {
+            using U = typename V::value_type;
+            const U *p = (const U*)a;
+            size_t i = 0;
+            if (n >= V::width) {
+                typename V::reg r = V::load(p);
+                for (i = V::width; i + V::width <= n; i += V::width) {
+                    r = V::min(r, V::load(p + i));
+                }
+                Tp t[V::width];
+                _mm_storeu_si128((__m128i*)t, (__m128i)r);
+                lo = scalar::min(t, V::width, lo);
+            }
+            return scalar::min(a + i, n - i, lo);
+        }
+
+        template <class V, class Tp>
+        Tp max(const Tp *a, size_t n, Tp hi) {
+            using U = typename V::value_type;
+            const U *p = (const U*)a;
+            size_t i = 0;
+            if (n >= V::width) {
+                typename V::reg r = V::load(p);
+                for (i = V::width; i + V::width <= n; i += V::width) {
+                    r = V::max(r, V::load(p + i));
+                }
+                Tp t[V::width];
+                _mm_storeu_si128((__m128i*)t, (__m128i)r);
+                hi = scalar::max(t, V::width, hi);
+            }
+            return scalar::max(a + i, n - i, hi);
+        }
+
+        template <class V, class Tp>
+        typename sum_type<Tp>::type sum(const Tp *a, size_t n) {
+            using U = typename V::value_type;
+            const U *p = (const U*)a;
+            typename V::acc s = V::zero();
+            size_t i = 0;
+            for (; i + V::width <= n; i += V::width) {
+                V::add(s, V::load(p + i));
+            }
+            return V::reduce(s) + scalar::sum(a + i, n - i);
+        }
+    }
+
+#define SJTU_AVX2 __attribute__((target("avx2")))
+
+    namespace avx2 {
+
+        struct i32 {
+            using value_type = int;
+            using reg = __m256i;
+            struct acc { __m256i lo, hi; };
+            static constexpr size_t width = 8;
+            SJTU_AVX2 static reg load(const value_type *p) { return _mm256_loadu_si256((const __m256i*)p); }
+            SJTU_AVX2 static reg set1(value_type v) { return _mm256_set1_epi32(v); }
+            SJTU_AVX2 static int eq(reg a, reg b) { return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b))); }
+            SJTU_AVX2 static int lt(reg a, reg b) { return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(b, a))); }
+            SJTU_AVX2 static reg min(reg a, reg b) { return _mm256_min_epi32(a, b); }
+            SJTU_AVX2 static reg max(reg a, reg b) { return _mm256_max_epi32(a, b); }
+            SJTU_AVX2 static acc zero() { return acc{_mm256_setzero_si256(), _mm256_setzero_si256()}; }
+            SJTU_AVX2 static void add(acc &s, reg x) {
+                s.lo = _mm256_add_epi64(s.lo, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(x)));
+                s.hi = _mm256_add_epi64(s.hi, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(x, 1)));
+            }
+            SJTU_AVX2 static long long reduce(const acc &s) {
+                long long t[4];
+                _mm256_storeu_si256((__m256i*)t, _mm256_add_epi64(s.lo, s.hi));
+                return (t[0] + t[1]) + (t[2] + t[3]);
+            }
+        };
+
+        struct i64 {
+            using value_type = long long;
+            using reg = __m256i;
+            using acc = __m256i;
+            static constexpr size_t width = 4;
+            SJTU_AVX2 static reg load(const void *p) { return _mm256_loadu_si256((const __m256i*)p); }
+            SJTU_AVX2 static reg set1(value_type v) { return _mm256_set1_epi64x(v); }
+            SJTU_AVX2 static int eq(reg a, reg b) { return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(a, b))); }
+            SJTU_AVX2 static int lt(reg a, reg b) { return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(b, a))); }
+            SJTU_AVX2 static reg min(reg a, reg b) { return _mm256_blendv_epi8(a, b, _mm256_cmpgt_epi64(a, b)); }
+            SJTU_AVX2 static reg max(reg a, reg b) { return _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi64(a, b)); }
+            SJTU_AVX2 static acc zero() { return _mm256_setzero_si256(); }
+            SJTU_AVX2 static void add(acc &s, reg x) { s = _mm256_add_epi64(s, x); }
+            SJTU_AVX2 static long long reduce(const acc &s) {
+                long long t[4];
+                _mm256_storeu_si256((__m256i*)t, s);
+                return (t[0] + t[1]) + (t[2] + t[3]);
+            }
+        };
+
+        struct f32 {
+            using value_type = float;
+            using reg = __m256;
+            using acc = __m256;
+            static constexpr size_t width = 8;
+            SJTU_AVX2 static reg load(const value_type *p) { return _mm256_loadu_ps(p); }
+            SJTU_AVX2 static reg set1(value_type v) { return _mm256_set1_ps(v); }
+            SJTU_AVX2 static int eq(reg a, reg b) { return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_EQ_OQ)); }
+            SJTU_AVX2 static int lt(reg a, reg b) { return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LT_OQ)); }
+            SJTU_AVX2 static reg min(reg a, reg b) { return _mm256_min_ps(a, b); }
+            SJTU_AVX2 static reg max(reg a, reg b) { return _mm256_max_ps(a, b); }
+            SJTU_AVX2 static acc zero() { return _mm256_setzero_ps(); }
+            SJTU_AVX2 static void add(acc &s, reg x) { s = _mm256_add_ps(s, x); }
+            SJTU_AVX2 static float reduce(const acc &s) {
+                float t[8];
+                _mm256_storeu_ps(t, s);
+                return ((t[0] + t[1]) + (t[2] + t[3])) + ((t[4] + t[5]) + (t[6] + t[7]));
+            }
+        };
+
+        struct f64 {
+            using value_type = double;
+            using reg = __m256d;
+            using acc = __m256d;
+            static constexpr size_t width = 4;
+            SJTU_AVX2 static reg load(const value_type *p) { return _mm256_loadu_pd(p); }
+            SJTU_AVX2 static reg set1(value_type v) { return _mm256_set1_pd(v); }
+            SJTU_AVX2 static int eq(reg a, reg b) { return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_EQ_OQ)); }
+            SJTU_AVX2 static int lt(reg a, reg b) { return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_LT_OQ)); }
+            SJTU_AVX2 static reg min(reg a, reg b) { return _mm256_min_pd(a, b); }
+            SJTU_AVX2 static reg max(reg a, reg b) { return _mm256_max_pd(a, b); }
+            SJTU_AVX2 static acc zero() { return _mm256_setzero_pd(); }
+            SJTU_AVX2 static void add(acc &s, reg x) { s = _mm256_add_pd(s, x); }
+            SJTU_AVX2 static double reduce(const acc &s) {
+                double t[4];
+                _mm256_storeu_pd(t, s);
+                return (t[0] + t[1]) + (t[2] + t[3]);
+            }
+        };
+
+        // the same loops as sse2, compiled for AVX2.
+
+        template <class V, class Tp>
+        SJTU_AVX2 size_t find(const Tp *a, size_t n, const Tp &v) {
+            using U = typename V::value_type;
+            const U *p = (const U*)a;
+            typename V::reg x = V::set1((U)v);
+            size_t i = 0;
+            for (; i + V::width <= n; i += V::width) {
+                int m = V::eq(V::load(p + i), x);
+                if (m) return i + __builtin_ctz(m);
+            }
+            return i + scalar::find(a + i, n - i, v);
+        }
+
+        template <class V, class Tp>
+        SJTU_AVX2 size_t count(const Tp *a, size_t n, const Tp &v) {
+            using U = typename V::value_type;
+            const U *p = (const U*)a;
+            typename V::reg x = V::set1((U)v);
+            size_t i = 0, ret = 0;
+            for (; i + V::width <= n; i += V::width) {
+                ret += __builtin_popcount(V::eq(V::load(p + i), x));
+            }
+            return ret + scalar::count(a + i, n - i, v);
+        }
+
+        template <class V, class Tp>
+        SJTU_AVX2 size_t count_less(const Tp *a, size_t n, const Tp &v) {
+            using U = typename V::value_type;
+            const U *p = (const U*)a;
+            typename V::reg x = V::set1((U)v);
+            size_t i = 0, ret = 0;
+            for (; i + V::width <= n; i += V::width) {
+                ret += __builtin_popcount(V::lt(V::load(p + i), x));
+            }
+            return ret + scalar::count_less(a + i, n - i, v);
+        }
+
+        template <class V, class Tp>
+        SJTU_AVX2 Tp min(const Tp *a, size_t n, Tp lo) {
+            using U = typename V::value_type;
+            const U *p = (const U*)a;
+            size_t i = 0;
+            if (n >= V::width) {
+                typename V::reg r = V::load(p);
+                for (i = V::width; i + V::width <= n; i += V::width) {
+                    r = V::min(r, V::load(p + i));
+                }
+                Tp t[V::width];
+                _mm256_storeu_si256((__m256i*)t, (__m256i)r);
+                lo = scalar::min(t, V::width, lo);
+            }
+            return scalar::min(a + i, n - i, lo);
+        }
+
+        template <class V, class Tp>
+        SJTU_AVX2 Tp max(const Tp *a, size_t n, Tp hi) {
+            using U = typename V::value_type;
+            const U *p = (const U*)a;
+            size_t i = 0;
+            if (n >= V::width) {
+                typename V::reg r = V::load(p);
+                for (i = V::width; i + V::width <= n; i += V::width) {
+                    r = V::max(r, V::load(p + i));
+                }
+                Tp t[V::width];
+                _mm256_storeu_si256((__m256i*)t, (__m256i)r);
+                hi = scalar::max(t, V::width, hi);
+            }
+            return scalar::max(a + i, n - i, hi);
+        }
+
+        template <class V, class Tp>
+        SJTU_AVX2 typename sum_type<Tp>::type sum(const Tp *a, size_t n) {
+            using U = typename V::value_type;
+            const U *p = (const U*)a;
+            typename V::acc s = V::zero();
+            size_t i = 0;
+            for (; i + V::width <= n; i += V::width) {
+                V::add(s, V::load(p + i));
+            }
+            return V::reduce(s) + scalar::sum(a + i, n - i);
+        }
+    }
+
+#undef SJTU_AVX2
+
+    inline bool has_avx2() {
+        static const bool ret = (__builtin_cpu_init(), __builtin_cpu_supports("avx2"));
+        return ret;
+    }
+
+    template <int K> struct ops { using sse2 = void; using avx2 = void; };
+    template <> struct ops<1> { using sse2 = simd::sse2::i32; using avx2 = simd::avx2::i32; };
+    template <> struct ops<2> { using sse2 = simd::sse2::i64; using avx2 = simd::avx2::i64; };
+    template <> struct ops<3> { using sse2 = simd::sse2::f32; using avx2 = simd::avx2::f32; };
+    template <> struct ops<4> { using sse2 = simd::sse2::f64; using avx2 = simd::avx2::f64; };
+
+    // dispatch: the tag picks the vector kernels, tag 0 the scalar ones.
+
+    template <class Tp>
+    size_t find(const Tp *a, size_t n, const Tp &v, std::integral_constant<int, 0>) { return scalar::find(a, n, v); }
+    template <class Tp, int K>
+    size_t find(const Tp *a, size_t n, const Tp &v, std::integral_constant<int, K>) {
+        return has_avx2() ? avx2::find<typename ops<K>::avx2>(a, n, v) : sse2::find<typename ops<K>::sse2>(a, n, v);
+    }
+
+    template <class Tp>
+    size_t count(const Tp *a, size_t n, const Tp &v, std::integral_constant<int, 0>) { return scalar::count(a, n, v); }
+    template <class Tp, int K>
+    size_t count(const Tp *a, size_t n, const Tp &v, std::integral_constant<int, K>) {
+        return has_avx2() ? avx2::count<typename ops<K>::avx2>(a, n, v) : sse2::count<typename ops<K>::sse2>(a, n, v);
+    }
+
+    template <class Tp>
+    size_t count_less(const Tp *a, size_t n, const Tp &v, std::integral_constant<int, 0>) { return scalar::count_less(a, n, v); }
+    template <class Tp, int K>
+    size_t count_less(const Tp *a, size_t n, const Tp &v, std::integral_constant<int, K>) {
+        return has_avx2() ? avx2::count_less<typename ops<K>::avx2>(a, n, v) : sse2::count_less<typename ops<K>::sse2>(a, n, v);
+    }
+
+    template <class Tp>
+    Tp min(const Tp *a, size_t n, Tp lo, std::integral_constant<int, 0>) { return scalar::min(a, n, lo); }
+    template <class Tp, int K>
+    Tp min(const Tp *a, size_t n, Tp lo, std::integral_constant<int, K>) {
+        return has_avx2() ? avx2::min<typename ops<K>::avx2>(a, n, lo) : sse2::min<typename ops<K>::sse2>(a, n, lo);
+    }
+
+    template <class Tp>
+    Tp max(const Tp *a, size_t n, Tp hi, std::integral_constant<int, 0>) { return scalar::max(a, n, hi); }
+    template <class Tp, int K>
+    Tp max(const Tp *a, size_t n, Tp hi, std::integral_constant<int, K>) {
+        return has_avx2() ? avx2::max<typename ops<K>::avx2>(a, n, hi) : sse2::max<typename ops<K>::sse2>(a, n, hi);
+    }
+
+    template <class Tp>
+    typename sum_type<Tp>::type sum(const Tp *a, size_t n, std::integral_constant<int, 0>) { return scalar::sum(a, n); }
+    template <class Tp, int K>
+    typename sum_type<Tp>::type sum(const Tp *a, size_t n, std::integral_constant<int, K>) {
+        return has_avx2() ? avx2::sum<typename ops<K>::avx2>(a, n) : sse2::sum<typename ops<K>::sse2>(a, n);
+    }
+
+    template <class Tp>
+    using tag = std::integral_constant<int, kind<Tp>::value>;
+
+#else
+
+    template <class Tp>
+    using tag = std::integral_constant<int, 0>;
+
+    template <class Tp>
+    size_t find(const Tp *a, size_t n, const Tp &v, tag<Tp>) { return scalar::find(a, n, v); }
+    template <class Tp>
+    size_t count(const Tp *a, size_t n, const Tp &v, tag<Tp>) { return scalar::count(a, n, v); }
+    template <class Tp>
+    size_t count_less(const Tp *a, size_t n, const Tp &v, tag<Tp>) { return scalar::count_less(a, n, v); }
+    template <class Tp>
+    Tp min(const Tp *a, size_t n, Tp lo, tag<Tp>) { return scalar::min(a, n, lo); }
+    template <class Tp>
+    Tp max(const Tp *a, size_t n, Tp hi, tag<Tp>) { return scalar::max(a, n, hi); }
+    template <class Tp>
+    typename sum_type<Tp>::type sum(const Tp *a, size_t n, tag<Tp>) { return scalar::sum(a, n); }
+
+#endif
+
+    template <class Tp>
+    size_t find(const Tp *a, size_t n, const Tp &v) { return simd::find(a, n, v, tag<Tp>()); }
+    template <class Tp>
+    size_t count(const Tp *a, size_t n, const Tp &v) { return simd::count(a, n, v, tag<Tp>()); }
+    template <class Tp>
+    size_t count_less(const Tp *a, size_t n, const Tp &v) { return simd::count_less(a, n, v, tag<Tp>()); }
+    template <class Tp>
+    Tp min(const Tp *a, size_t n, Tp lo) { return simd::min(a, n, lo, tag<Tp>()); }
+    template <class Tp>
+    Tp max(const Tp *a, size_t n, Tp hi) { return simd::max(a, n, hi, tag<Tp>()); }
+    template <class Tp>
+    typename sum_type<Tp>::type sum(const Tp *a, size_t n) { return simd::sum(a, n, tag<Tp>()); }
+}
+
+}
+
+#endif
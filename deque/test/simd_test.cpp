@@ -0,0 +1,135 @@
+// deque find/count/min/max/sum against plain iterator loops, and every
+// simd kernel family this machine has against the scalar one.
+//   g++ -std=c++17 -O2 -I.. simd_test.cpp -o simd_test
+//   ./simd_test
+#include "deque.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        exit(1); \
+    } \
+} while (0)
+
+static std::mt19937 rng(1);
+
+// small values, so that there are repeats and float sums are exact.
+template <class Tp>
+static Tp any() { return (Tp)(rng() % 200) - (Tp)(std::is_signed<Tp>::value ? 100 : 0); }
+
+// a deque whose blocks start at different offsets: pushed at both ends,
+// with some elements erased from the middle.
+template <class Tp>
+static void fill(sjtu::deque<Tp> &d, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        if (rng() % 3 == 0) d.push_front(any<Tp>());
+        else d.push_back(any<Tp>());
+    }
+    for (size_t i = 0; i < n / 10 && d.size() > 1; ++i) {
+        d.erase(d.begin() + rng() % d.size());
+    }
+}
+
+template <class Tp>
+static void check_deque(size_t n) {
+    sjtu::deque<Tp> d;
+    fill(d, n);
+    const sjtu::deque<Tp> &cd = d;
+    for (int round = 0; round < 20; ++round) {
+        Tp v = any<Tp>();
+        auto want = d.begin();
+        size_t want_count = 0;
+        for (auto it = d.begin(); it != d.end(); ++it) {
+            if (*it == v) {
+                if (!want_count) want = it;
+                ++want_count;
+            }
+        }
+        if (!want_count) want = d.end();
+        CHECK(d.find(v) == want);
+        CHECK(cd.find(v) == cd.cbegin() + (want - d.begin()));
+        CHECK(d.count(v) == want_count);
+    }
+    typename sjtu::simd::sum_type<Tp>::type sum = 0;
+    for (auto it = d.begin(); it != d.end(); ++it) sum += *it;
+    CHECK(d.sum() == sum);
+    if (d.empty()) {
+        bool threw = false;
+        try {
+            d.min();
+        } catch (sjtu::container_is_empty &) {
+            threw = true;
+        }
+        CHECK(threw);
+        return;
+    }
+    Tp lo = d.front(), hi = d.front();
+    for (auto it = d.begin(); it != d.end(); ++it) {
+        if (*it < lo) lo = *it;
+        if (hi < *it) hi = *it;
+    }
+    CHECK(d.min() == lo);
+    CHECK(d.max() == hi);
+}
+
+#ifdef SJTU_SIMD_X86
+// run the kernels of one family on every length and offset up to a few
+// vectors wide, against the scalar loops.
+template <class Tp, class Sse2, class Avx2>
+static void check_kernels() {
+    std::vector<Tp> a(200);
+    for (Tp &x : a) x = any<Tp>();
+    for (size_t off = 0; off < 8; ++off) {
+        for (size_t n = 0; off + n <= 80; ++n) {
+            const Tp *p = a.data() + off;
+            Tp v = n ? p[rng() % n] : any<Tp>();
+            Tp w = any<Tp>();
+            namespace s = sjtu::simd;
+            CHECK(s::sse2::find<Sse2>(p, n, v) == s::scalar::find(p, n, v));
+            CHECK(s::sse2::find<Sse2>(p, n, w) == s::scalar::find(p, n, w));
+            CHECK(s::sse2::count<Sse2>(p, n, v) == s::scalar::count(p, n, v));
+            CHECK(s::sse2::count_less<Sse2>(p, n, v) == s::scalar::count_less(p, n, v));
+            CHECK(s::sse2::min<Sse2>(p, n, w) == s::scalar::min(p, n, w));
+            CHECK(s::sse2::max<Sse2>(p, n, w) == s::scalar::max(p, n, w));
+            CHECK(s::sse2::sum<Sse2>(p, n) == s::scalar::sum(p, n));
+            if (!s::has_avx2()) continue;
+            CHECK(s::avx2::find<Avx2>(p, n, v) == s::scalar::find(p, n, v));
+            CHECK(s::avx2::find<Avx2>(p, n, w) == s::scalar::find(p, n, w));
+            CHECK(s::avx2::count<Avx2>(p, n, v) == s::scalar::count(p, n, v));
+            CHECK(s::avx2::count_less<Avx2>(p, n, v) == s::scalar::count_less(p, n, v));
+            CHECK(s::avx2::min<Avx2>(p, n, w) == s::scalar::min(p, n, w));
+            CHECK(s::avx2::max<Avx2>(p, n, w) == s::scalar::max(p, n, w));
+            CHECK(s::avx2::sum<Avx2>(p, n) == s::scalar::sum(p, n));
+        }
+    }
+}
+#endif
+
+template <class Tp>
+static void check_type() {
+    for (size_t n : {0, 1, 7, 100, 1000, 20000}) check_deque<Tp>(n);
+}
+
+int main() {
+    check_type<int>();
+    check_type<long long>();
+    check_type<float>();
+    check_type<double>();
+    check_type<short>();
+    check_type<unsigned>();
+#ifdef SJTU_SIMD_X86
+    namespace s = sjtu::simd;
+    check_kernels<int, s::sse2::i32, s::avx2::i32>();
+    check_kernels<long long, s::sse2::i64, s::avx2::i64>();
+    check_kernels<float, s::sse2::f32, s::avx2::f32>();
+    check_kernels<double, s::sse2::f64, s::avx2::f64>();
+    printf("ok, %s\n", s::has_avx2() ? "sse2 and avx2" : "sse2 only");
+#else
+    printf("ok, scalar only\n");
+#endif
+    return 0;
+}
@@ -1,6 +1,8 @@
 #ifndef SJTU_UTILITY_HPP
 #define SJTU_UTILITY_HPP
 
+#include <cstddef>
+#include <tuple>
 #include <utility>
 
 namespace sjtu {
@@ -20,6 +22,14 @@ public:
 	pair(const pair<U1, U2> &other) : first(other.first), second(other.second) {}
 	template<class U1, class U2>
 	pair(pair<U1, U2> &&other) : first(other.first), second(other.second) {}
+	// first is built from the elements of x, second from those of y.
+	template<class... A1, class... A2>
+	pair(std::piecewise_construct_t, std::tuple<A1...> x, std::tuple<A2...> y) :
+		pair(x, y, std::index_sequence_for<A1...>(), std::index_sequence_for<A2...>()) {}
+private:
+	template<class X, class Y, std::size_t... I1, std::size_t... I2>
+	pair(X &x, Y &y, std::index_sequence<I1...>, std::index_sequence<I2...>) :
+		first(std::get<I1>(std::move(x))...), second(std::get<I2>(std::move(y))...) {}
 };
 
 }
@@ -0,0 +1,73 @@
+// lookups and memory of btree_map against map, on random int keys.
+//   g++ -std=c++17 -O2 -DNDEBUG -I.. -I../../deque btree_map_bench.cpp -o btree_map_bench
+//   ./btree_map_bench [n]
+#include "btree_map.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+// every byte the containers ask for goes through here.
+static size_t live_bytes = 0;
+
+template <class T>
+struct counting_allocator {
+	using value_type = T;
+	counting_allocator() = default;
+	template <class U>
+	counting_allocator(const counting_allocator<U> &) {}
+	T * allocate(size_t n) {
+		live_bytes += n * sizeof(T);
+		return std::allocator<T>().allocate(n);
+	}
+	void deallocate(T *p, size_t n) {
+		live_bytes -= n * sizeof(T);
+		std::allocator<T>().deallocate(p, n);
+	}
+	template <class U>
+	bool operator==(const counting_allocator<U> &) const { return true; }
+	template <class U>
+	bool operator!=(const counting_allocator<U> &) const { return false; }
+};
+
+static double seconds_since(std::chrono::steady_clock::time_point t) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+}
+
+template <class Map>
+static void run(const char *name, const std::vector<int> &keys, const std::vector<int> &probes) {
+	size_t before = live_bytes;
+	auto t = std::chrono::steady_clock::now();
+	Map m;
+	for (int k : keys) m[k] = k;
+	double insert = seconds_since(t);
+	size_t bytes = live_bytes - before;
+
+	t = std::chrono::steady_clock::now();
+	long long sum = 0;
+	for (int k : probes) {
+		auto it = m.find(k);
+		if (it != m.end()) sum += it->second;
+	}
+	double find = seconds_since(t);
+
+	printf("%-10s insert %7.3f s  find %7.3f s  %6.1f ns/find  %8.1f MB  %5.1f B/element  (%lld)\n",
+		name, insert, find, find * 1e9 / probes.size(), bytes / 1048576.0,
+		(double)bytes / m.size(), sum);
+}
+
+int main(int argc, char **argv) {
+	size_t n = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+	std::mt19937 rng(1);
+	std::vector<int> keys(n), probes(4 * n);
+	for (int &k : keys) k = (int)rng();
+	// three quarters of the probes hit.
+	for (size_t i = 0; i < probes.size(); ++i) probes[i] = i % 4 ? keys[rng() % n] : (int)rng();
+
+	using alloc = counting_allocator<sjtu::pair<const int, int>>;
+	run<sjtu::map<int, int, std::less<int>, alloc>>("map", keys, probes);
+	run<sjtu::btree_map<int, int, std::less<int>, alloc>>("btree_map", keys, probes);
+	return 0;
+}
@@ -0,0 +1,118 @@
+// throughput of concurrent_map against one map behind a mutex, with
+// 1, 2, 4, ... threads doing lookups and some writes on random keys.
+//   g++ -std=c++17 -O2 -DNDEBUG -pthread -I.. -I../../deque concurrent_map_bench.cpp -o concurrent_map_bench
+//   ./concurrent_map_bench [max threads] [percent writes]
+#include "concurrent_map.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+static const int key_range = 1 << 20;
+static const int ops_per_thread = 1000000;
+
+// the setup the request started from: one map, one lock.
+struct locked_map {
+	sjtu::map<int, int> m;
+	mutable std::mutex lock;
+	bool find(int k, int &v) const {
+		std::lock_guard<std::mutex> g(lock);
+		const int *p = m.try_at(k);
+		if (p) v = *p;
+		return p != nullptr;
+	}
+	void insert_or_assign(int k, int v) {
+		std::lock_guard<std::mutex> g(lock);
+		m.insert_or_assign(k, v);
+	}
+	void erase(int k) {
+		std::lock_guard<std::mutex> g(lock);
+		m.erase(k);
+	}
+};
+
+struct rw_locked_map {
+	sjtu::map<int, int> m;
+	mutable std::shared_mutex lock;
+	bool find(int k, int &v) const {
+		std::shared_lock<std::shared_mutex> g(lock);
+		const int *p = m.try_at(k);
+		if (p) v = *p;
+		return p != nullptr;
+	}
+	void insert_or_assign(int k, int v) {
+		std::unique_lock<std::shared_mutex> g(lock);
+		m.insert_or_assign(k, v);
+	}
+	void erase(int k) {
+		std::unique_lock<std::shared_mutex> g(lock);
+		m.erase(k);
+	}
+};
+
+// half the keys are there to start with; writes are half inserts, half
+// erases, so that stays about the same.
+template <class Map>
+static double run(Map &m, int threads, int write_percent) {
+	std::atomic<int> ready(0);
+	std::atomic<bool> go(false);
+	std::atomic<long long> hits(0);
+	std::vector<std::thread> pool;
+	for (int t = 0; t < threads; ++t) {
+		pool.emplace_back([&, t] {
+			std::mt19937 rng(t + 1);
+			++ready;
+			while (!go) std::this_thread::yield();
+			long long h = 0;
+			for (int i = 0; i < ops_per_thread; ++i) {
+				int k = (int)(rng() % key_range);
+				int r = (int)(rng() % 200);
+				int v;
+				if (r < 2 * write_percent) {
+					if (r & 1) m.erase(k);
+					else m.insert_or_assign(k, k);
+				} else {
+					h += m.find(k, v);
+				}
+			}
+			hits += h;
+		});
+	}
+	while (ready < threads) std::this_thread::yield();
+	auto start = std::chrono::steady_clock::now();
+	go = true;
+	for (std::thread &t : pool) t.join();
+	double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return threads * (double)ops_per_thread / s / 1e6;
+}
+
+template <class Map>
+static void fill(Map &m) {
+	for (int k = 0; k < key_range; k += 2) m.insert_or_assign(k, k);
+}
+
+int main(int argc, char **argv) {
+	int max_threads = argc > 1 ? atoi(argv[1]) : (int)std::thread::hardware_concurrency();
+	int write_percent = argc > 2 ? atoi(argv[2]) : 10;
+	if (max_threads < 1) max_threads = 1;
+	printf("%d%% writes, %d keys, million operations a second\n", write_percent, key_range);
+	printf("%8s %14s %14s %14s\n", "threads", "map+mutex", "map+rwlock", "concurrent_map");
+	for (int threads = 1; threads <= max_threads; threads *= 2) {
+		locked_map a;
+		rw_locked_map b;
+		sjtu::concurrent_map<int, int> c;
+		fill(a);
+		fill(b);
+		fill(c);
+		double ta = run(a, threads, write_percent);
+		double tb = run(b, threads, write_percent);
+		double tc = run(c, threads, write_percent);
+		printf("%8d %14.2f %14.2f %14.2f\n", threads, ta, tb, tc);
+	}
+	return 0;
+}
@@ -0,0 +1,79 @@
+// lookups in map::freeze() against map::find and a binary search over
+// the same sorted keys, 100M keys by default.
+//   g++ -std=c++17 -O2 -DNDEBUG -I.. -I../../deque frozen_map_bench.cpp -o frozen_map_bench
+//   ./frozen_map_bench [keys] [lookups]
+// 100M keys need about 6 GB: the map and the frozen copy are both alive
+// while the copy is made.
+#include "map.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using key_type = uint32_t;
+
+static double seconds_since(std::chrono::steady_clock::time_point t) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+}
+
+static void report(const char *name, double s, size_t lookups, unsigned long long check) {
+	printf("%-16s %8.3f s  %7.1f ns/lookup  (%llu)\n", name, s, s * 1e9 / lookups, check);
+}
+
+int main(int argc, char **argv) {
+	size_t n = argc > 1 ? strtoull(argv[1], nullptr, 10) : 100000000;
+	size_t lookups = argc > 2 ? strtoull(argv[2], nullptr, 10) : 10000000;
+	std::mt19937 rng(1);
+
+	// ascending keys with random gaps, so that about half the probes miss.
+	sjtu::map<key_type, key_type> m;
+	{
+		std::vector<sjtu::pair<const key_type, key_type>> sorted;
+		sorted.reserve(n);
+		key_type k = 0;
+		for (size_t i = 0; i < n; ++i) {
+			k += 1 + rng() % 40;
+			sorted.emplace_back(k, (key_type)i);
+		}
+		m.assign_sorted(sorted.begin(), sorted.end());
+	}
+	key_type top = m.empty() ? 1 : (--m.end())->first + 1;
+	std::vector<key_type> probes(lookups);
+	for (key_type &p : probes) p = (key_type)(rng() % top);
+	printf("%zu keys, %zu lookups\n", n, lookups);
+
+	auto t = std::chrono::steady_clock::now();
+	unsigned long long check = 0;
+	for (key_type p : probes) {
+		auto it = m.find(p);
+		if (it != m.end()) check += it->second;
+	}
+	report("map::find", seconds_since(t), lookups, check);
+
+	auto f = m.freeze();
+	m.clear();
+	std::vector<key_type> keys;
+	keys.reserve(f.size());
+	for (auto it = f.cbegin(); it != f.cend(); ++it) keys.push_back(it->first);
+
+	t = std::chrono::steady_clock::now();
+	check = 0;
+	for (key_type p : probes) {
+		auto it = f.find(p);
+		if (it != f.cend()) check += it->second;
+	}
+	report("frozen_map::find", seconds_since(t), lookups, check);
+
+	// the index of the key stands in for the value, which is the same.
+	t = std::chrono::steady_clock::now();
+	check = 0;
+	for (key_type p : probes) {
+		auto it = std::lower_bound(keys.begin(), keys.end(), p);
+		if (it != keys.end() && *it == p) check += it - keys.begin();
+	}
+	report("std::lower_bound", seconds_since(t), lookups, check);
+	return 0;
+}
@@ -0,0 +1,743 @@
+#ifndef SJTU_BTREE_MAP_HPP
+#define SJTU_BTREE_MAP_HPP
+
+#include <functional>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <utility>
+#include "map.hpp"
+
+namespace sjtu {
+
+// an ordered map with many elements per node, so that a lookup reads a few
+// cache lines per level instead of one node per key.
+// the elements live in the leaves, which are linked for iteration; inner
+// nodes only hold separator keys. insert and erase move elements between
+// nodes, so they invalidate iterators.
+template<
+	class Key,
+	class T,
+	class Compare = std::less<Key>,
+	class Allocator = std::allocator<pair<const Key, T>>
+> class btree_map : private compare_holder<Compare> {
+public:
+	using value_type = pair<const Key, T>;
+	using allocator_type = Allocator;
+	using key_compare = Compare;
+private:
+	using compare_holder<Compare>::comp;
+
+	// nodes take about node_bytes, a few cache lines.
+	static constexpr size_t node_bytes = 256;
+	static constexpr size_t leaf_max = node_bytes / sizeof(value_type) > 4 ? node_bytes / sizeof(value_type) : 4;
+	static constexpr size_t leaf_min = leaf_max / 2;
+	// counted in children.
+	static constexpr size_t inner_max = node_bytes / (sizeof(Key) + sizeof(void*)) > 4 ? node_bytes / (sizeof(Key) + sizeof(void*)) : 4;
+	static constexpr size_t inner_min = inner_max / 2;
+	// fanout is at least 2, so this covers any size_t element count.
+	static constexpr size_t max_height = 64;
+
+	struct leaf_node {
+		size_t n;
+		leaf_node *prev, *next;
+		alignas(value_type) unsigned char storage[leaf_max * sizeof(value_type)];
+		value_type* slot(size_t i) { return reinterpret_cast<value_type*>(storage) + i; }
+		const Key& key(size_t i) { return slot(i)->first; }
+	};
+
+	// child i holds the keys in [key(i - 1), key(i)).
+	struct inner_node {
+		size_t n;
+		void *child[inner_max];
+		alignas(Key) unsigned char storage[(inner_max - 1) * sizeof(Key)];
+		Key* key(size_t i) { return reinterpret_cast<Key*>(storage) + i; }
+	};
+
+	using alloc_traits = std::allocator_traits<Allocator>;
+	using leaf_allocator = typename alloc_traits::template rebind_alloc<leaf_node>;
+	using leaf_traits = std::allocator_traits<leaf_allocator>;
+	using inner_allocator = typename alloc_traits::template rebind_alloc<inner_node>;
+	using inner_traits = std::allocator_traits<inner_allocator>;
+
+	// the root is a leaf when height is 0.
+	void *root;
+	size_t height;
+	leaf_node *leftmost, *rightmost;
+	size_t tree_size;
+	Allocator alloc;
+
+	// the way down to a leaf: path[d] is the inner node on depth d,
+	// idx[d] the child taken there.
+	struct tree_path {
+		inner_node *node[max_height];
+		size_t idx[max_height];
+	};
+
+	leaf_node* new_leaf() {
+		leaf_allocator la(alloc);
+		leaf_node *l = leaf_traits::allocate(la, 1);
+		l->n = 0;
+		l->prev = l->next = nullptr;
+		return l;
+	}
+
+	void free_leaf(leaf_node *l) {
+		leaf_allocator la(alloc);
+		leaf_traits::deallocate(la, l, 1);
+	}
+
+	inner_node* new_inner() {
+		inner_allocator ia(alloc);
+		inner_node *p = inner_traits::allocate(ia, 1);
+		p->n = 0;
+		return p;
+	}
+
+	void free_inner(inner_node *p) {
+		inner_allocator ia(alloc);
+		inner_traits::deallocate(ia, p, 1);
+	}
+
+	void move_slot(value_type *dst, value_type *src) {
+		alloc_traits::construct(alloc, dst, std::move(*src));
+		alloc_traits::destroy(alloc, src);
+	}
+
+	static void move_key(Key *dst, Key *src) {
+		new (dst) Key(std::move(*src));
+		src->~Key();
+	}
+
+	// first slot of l whose key is not less than key.
+	template <class K>
+	size_t leaf_lower(leaf_node *l, const K &key) const {
+		size_t lo = 0, hi = l->n;
+		while (lo < hi) {
+			size_t mid = (lo + hi) / 2;
+			if (comp()(l->key(mid), key))
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		return lo;
+	}
+
+	// the child of p that may hold key.
+	template <class K>
+	size_t inner_child(inner_node *p, const K &key) const {
+		size_t lo = 0, hi = p->n - 1;
+		while (lo < hi) {
+			size_t mid = (lo + hi) / 2;
+			if (comp()(key, *p->key(mid)))
+				hi = mid;
+			else
+				lo = mid + 1;
+		}
+		return lo;
+	}
+
+	template <class K>
+	leaf_node* descend(const K &key) const {
+		void *x = root;
+		for (size_t d = 0; d < height; ++d) {
+			inner_node *p = static_cast<inner_node*>(x);
+			x = p->child[inner_child(p, key)];
+		}
+		return static_cast<leaf_node*>(x);
+	}
+
+	template <class K>
+	leaf_node* descend(const K &key, tree_path &path) const {
+		void *x = root;
+		for (size_t d = 0; d < height; ++d) {
+			inner_node *p = static_cast<inner_node*>(x);
+			path.node[d] = p;
+			path.idx[d] = inner_child(p, key);
+			x = p->child[path.idx[d]];
+		}
+		return static_cast<leaf_node*>(x);
+	}
+
+	template <class K>
+	bool tree_find(const K &key, leaf_node *&l, size_t &i) const {
+		l = descend(key);
+		i = leaf_lower(l, key);
+		return i < l->n && !comp()(key, l->key(i));
+	}
+
+	// construct an element at i, moving the later ones up. l is not full.
+	template <class... Args>
+	void leaf_emplace(leaf_node *l, size_t i, Args&&... args) {
+		for (size_t j = l->n; j > i; --j) move_slot(l->slot(j), l->slot(j - 1));
+		try {
+			alloc_traits::construct(alloc, l->slot(i), std::forward<Args>(args)...);
+		} catch (...) {
+			for (size_t j = i; j < l->n; ++j) move_slot(l->slot(j), l->slot(j + 1));
+			throw;
+		}
+		++l->n;
+	}
+
+	void leaf_erase(leaf_node *l, size_t i) {
+		alloc_traits::destroy(alloc, l->slot(i));
+		for (size_t j = i + 1; j < l->n; ++j) move_slot(l->slot(j - 1), l->slot(j));
+		--l->n;
+	}
+
+	// put sep and r right after child c - 1 of p. p is not full.
+	void inner_insert(inner_node *p, size_t c, Key &sep, void *r) {
+		for (size_t j = p->n; j > c; --j) p->child[j] = p->child[j - 1];
+		for (size_t j = p->n - 1; j > c - 1; --j) move_key(p->key(j), p->key(j - 1));
+		new (p->key(c - 1)) Key(std::move(sep));
+		p->child[c] = r;
+		++p->n;
+	}
+
+	// drop key k and child k + 1 of p.
+	void inner_erase(inner_node *p, size_t k) {
+		p->key(k)->~Key();
+		for (size_t j = k + 1; j + 1 < p->n; ++j) move_key(p->key(j - 1), p->key(j));
+		for (size_t j = k + 2; j < p->n; ++j) p->child[j - 1] = p->child[j];
+		--p->n;
+	}
+
+	// r was split off to the right of the node reached by path on depth d;
+	// its keys are not less than sep. link it, splitting upwards as needed.
+	void link_split(tree_path &path, size_t d, Key sep, void *r) {
+		while (d > 0) {
+			--d;
+			inner_node *p = path.node[d];
+			size_t c = path.idx[d] + 1;
+			if (p->n < inner_max) {
+				inner_insert(p, c, sep, r);
+				return;
+			}
+			size_t mid = inner_max / 2;
+			inner_node *q = new_inner();
+			Key up(std::move(*p->key(mid - 1)));
+			p->key(mid - 1)->~Key();
+			for (size_t j = mid; j + 1 < p->n; ++j) move_key(q->key(j - mid), p->key(j));
+			for (size_t j = mid; j < p->n; ++j) q->child[j - mid] = p->child[j];
+			q->n = p->n - mid;
+			p->n = mid;
+			if (c <= mid)
+				inner_insert(p, c, sep, r);
+			else
+				inner_insert(q, c - mid, sep, r);
+			sep = std::move(up);
+			r = q;
+		}
+		inner_node *p = new_inner();
+		new (p->key(0)) Key(std::move(sep));
+		p->child[0] = root;
+		p->child[1] = r;
+		p->n = 2;
+		root = p;
+		++height;
+	}
+
+	// find key, or build an element from args at its place. args are left
+	// alone when key is there.
+	template <class K, class... Args>
+	pair<leaf_node*, size_t> tree_get_or_emplace(const K &key, bool &inserted, Args&&... args) {
+		tree_path path;
+		leaf_node *l = descend(key, path);
+		size_t i = leaf_lower(l, key);
+		inserted = false;
+		if (i < l->n && !comp()(key, l->key(i))) {
+			return pair<leaf_node*, size_t>(l, i);
+		}
+		if (l->n == leaf_max) {
+			// appending to the last leaf leaves it (nearly) full, so that
+			// ascending inserts pack the leaves.
+			size_t mid = (l == rightmost && i == l->n) ? leaf_max - 1 : leaf_max / 2;
+			leaf_node *r = new_leaf();
+			for (size_t j = mid; j < l->n; ++j) move_slot(r->slot(j - mid), l->slot(j));
+			r->n = l->n - mid;
+			l->n = mid;
+			r->prev = l;
+			r->next = l->next;
+			if (l->next) l->next->prev = r;
+			else rightmost = r;
+			l->next = r;
+			link_split(path, height, Key(r->key(0)), r);
+			if (i > mid) {
+				l = r;
+				i -= mid;
+			}
+		}
+		leaf_emplace(l, i, std::forward<Args>(args)...);
+		++tree_size;
+		inserted = true;
+		return pair<leaf_node*, size_t>(l, i);
+	}
+
+	void leaf_merge(leaf_node *l, leaf_node *r) {
+		for (size_t j = 0; j < r->n; ++j) move_slot(l->slot(l->n + j), r->slot(j));
+		l->n += r->n;
+		l->next = r->next;
+		if (r->next) r->next->prev = l;
+		else rightmost = l;
+		free_leaf(r);
+	}
+
+	// a takes the separator k of p and everything of b, its right sibling.
+	void inner_merge(inner_node *p, size_t k, inner_node *a, inner_node *b) {
+		new (a->key(a->n - 1)) Key(std::move(*p->key(k)));
+		for (size_t j = 0; j + 1 < b->n; ++j) move_key(a->key(a->n + j), b->key(j));
+		for (size_t j = 0; j < b->n; ++j) a->child[a->n + j] = b->child[j];
+		a->n += b->n;
+		free_inner(b);
+		inner_erase(p, k);
+	}
+
+	// restore the fill of the leaf reached by path, after an erase.
+	void fix_leaf(tree_path &path, leaf_node *l) {
+		if (height == 0 || l->n >= leaf_min) return;
+		inner_node *p = path.node[height - 1];
+		size_t c = path.idx[height - 1];
+		leaf_node *left = c > 0 ? static_cast<leaf_node*>(p->child[c - 1]) : nullptr;
+		leaf_node *right = c + 1 < p->n ? static_cast<leaf_node*>(p->child[c + 1]) : nullptr;
+		if (left && left->n > leaf_min) {
+			for (size_t j = l->n; j > 0; --j) move_slot(l->slot(j), l->slot(j - 1));
+			move_slot(l->slot(0), left->slot(left->n - 1));
+			--left->n;
+			++l->n;
+			*p->key(c - 1) = l->key(0);
+			return;
+		}
+		if (right && right->n > leaf_min) {
+			move_slot(l->slot(l->n), right->slot(0));
+			++l->n;
+			for (size_t j = 1; j < right->n; ++j) move_slot(right->slot(j - 1), right->slot(j));
+			--right->n;
+			*p->key(c) = right->key(0);
+			return;
+		}
+		if (right) {
+			leaf_merge(l, right);
+			inner_erase(p, c);
+		} else {
+			leaf_merge(left, l);
+			inner_erase(p, c - 1);
+		}
+		fix_inner(path, height - 1);
+	}
+
+	void fix_inner(tree_path &path, size_t d) {
+		for (;;) {
+			inner_node *x = path.node[d];
+			if (d == 0) {
+				if (x->n == 1) {
+					root = x->child[0];
+					free_inner(x);
+					--height;
+				}
+				return;
+			}
+			if (x->n >= inner_min) return;
+			inner_node *p = path.node[d - 1];
+			size_t c = path.idx[d - 1];
+			inner_node *left = c > 0 ? static_cast<inner_node*>(p->child[c - 1]) : nullptr;
+			inner_node *right = c + 1 < p->n ? static_cast<inner_node*>(p->child[c + 1]) : nullptr;
+			if (left && left->n > inner_min) {
+				for (size_t j = x->n; j > 0; --j) x->child[j] = x->child[j - 1];
+				for (size_t j = x->n - 1; j > 0; --j) move_key(x->key(j), x->key(j - 1));
+				move_key(x->key(0), p->key(c - 1));
+				x->child[0] = left->child[left->n - 1];
+				move_key(p->key(c - 1), left->key(left->n - 2));
+				--left->n;
+				++x->n;
+				return;
+			}
+			if (right && right->n > inner_min) {
+				move_key(x->key(x->n - 1), p->key(c));
+				x->child[x->n] = right->child[0];
+				++x->n;
+				move_key(p->key(c), right->key(0));
+				for (size_t j = 1; j + 1 < right->n; ++j) move_key(right->key(j - 1), right->key(j));
+				for (size_t j = 1; j < right->n; ++j) right->child[j - 1] = right->child[j];
+				--right->n;
+				return;
+			}
+			if (right)
+				inner_merge(p, c, x, right);
+			else
+				inner_merge(p, c - 1, left, x);
+			--d;
+		}
+	}
+
+	void tree_erase(leaf_node *l, size_t i) {
+		tree_path path;
+		descend(l->key(i), path);
+		leaf_erase(l, i);
+		--tree_size;
+		fix_leaf(path, l);
+	}
+
+	void free_tree(void *x, size_t h) {
+		if (h == 0) {
+			leaf_node *l = static_cast<leaf_node*>(x);
+			for (size_t j = 0; j < l->n; ++j) alloc_traits::destroy(alloc, l->slot(j));
+			free_leaf(l);
+			return;
+		}
+		inner_node *p = static_cast<inner_node*>(x);
+		for (size_t j = 0; j < p->n; ++j) free_tree(p->child[j], h - 1);
+		for (size_t j = 0; j + 1 < p->n; ++j) p->key(j)->~Key();
+		free_inner(p);
+	}
+
+	// copy a subtree of height h, linking its leaves after last.
+	void* tree_copy(void *x, size_t h, leaf_node *&last) {
+		if (h == 0) {
+			leaf_node *s = static_cast<leaf_node*>(x), *l = new_leaf();
+			for (; l->n < s->n; ++l->n) alloc_traits::construct(alloc, l->slot(l->n), *s->slot(l->n));
+			l->prev = last;
+			if (last) last->next = l;
+			else leftmost = l;
+			last = l;
+			return l;
+		}
+		inner_node *s = static_cast<inner_node*>(x), *p = new_inner();
+		for (size_t j = 0; j + 1 < s->n; ++j) new (p->key(j)) Key(*s->key(j));
+		for (; p->n < s->n; ++p->n) p->child[p->n] = tree_copy(s->child[p->n], h - 1, last);
+		return p;
+	}
+
+	void init_empty() {
+		root = leftmost = rightmost = new_leaf();
+		height = 0;
+		tree_size = 0;
+	}
+
+	void copy_from(const btree_map &other) {
+		leaf_node *last = nullptr;
+		root = tree_copy(other.root, other.height, last);
+		rightmost = last;
+		height = other.height;
+		tree_size = other.tree_size;
+	}
+
+public:
+	class const_iterator;
+	class iterator {
+		friend class btree_map;
+		btree_map *mp_belong;
+		leaf_node *leaf;
+		size_t i;
+		iterator(btree_map *mp_belong, leaf_node *leaf, size_t i) : mp_belong(mp_belong), leaf(leaf), i(i) {}
+	public:
+		iterator() : mp_belong(nullptr), leaf(nullptr), i(0) {}
+
+		iterator & operator++() {
+			if (!mp_belong || !leaf) throw invalid_iterator();
+			if (++i == leaf->n) {
+				leaf = leaf->next;
+				i = 0;
+			}
+			return *this;
+		}
+		iterator operator++(int) {
+			iterator tmp = *this;
+			++*this;
+			return tmp;
+		}
+
+		iterator & operator--() {
+			if (!mp_belong) throw invalid_iterator();
+			if (!leaf) {
+				if (mp_belong->empty()) throw invalid_iterator();
+				leaf = mp_belong->rightmost;
+				i = leaf->n - 1;
+			} else if (i > 0) {
+				--i;
+			} else {
+				if (!leaf->prev) throw invalid_iterator();
+				leaf = leaf->prev;
+				i = leaf->n - 1;
+			}
+			return *this;
+		}
+		iterator operator--(int) {
+			iterator tmp = *this;
+			--*this;
+			return tmp;
+		}
+
+		value_type & operator*() const { return *leaf->slot(i); }
+		value_type * operator->() const noexcept { return leaf->slot(i); }
+
+		bool operator==(const iterator &rhs) const {
+			return mp_belong == rhs.mp_belong && leaf == rhs.leaf && i == rhs.i;
+		}
+		bool operator==(const const_iterator &rhs) const {
+			return mp_belong == rhs.mp_belong && leaf == rhs.leaf && i == rhs.i;
+		}
+		bool operator!=(const iterator &rhs) const { return !(*this == rhs); }
+		bool operator!=(const const_iterator &rhs) const { return !(*this == rhs); }
+	};
+	class const_iterator {
+		friend class btree_map;
+		const btree_map *mp_belong;
+		leaf_node *leaf;
+		size_t i;
+		const_iterator(const btree_map *mp_belong, leaf_node *leaf, size_t i) : mp_belong(mp_belong), leaf(leaf), i(i) {}
+	public:
+		const_iterator() : mp_belong(nullptr), leaf(nullptr), i(0) {}
+		const_iterator(const iterator &other) : mp_belong(other.mp_belong), leaf(other.leaf), i(other.i) {}
+
+		const_iterator & operator++() {
+			if (!mp_belong || !leaf) throw invalid_iterator();
+			if (++i == leaf->n) {
+				leaf = leaf->next;
+				i = 0;
+			}
+			return *this;
+		}
+		const_iterator operator++(int) {
+			const_iterator tmp = *this;
+			++*this;
+			return tmp;
+		}
+
+		const_iterator & operator--() {
+			if (!mp_belong) throw invalid_iterator();
+			if (!leaf) {
+				if (mp_belong->empty()) throw invalid_iterator();
+				leaf = mp_belong->rightmost;
+				i = leaf->n - 1;
+			} else if (i > 0) {
+				--i;
+			} else {
+				if (!leaf->prev) throw invalid_iterator();
+				leaf = leaf->prev;
+				i = leaf->n - 1;
+			}
+			return *this;
+		}
+		const_iterator operator--(int) {
+			const_iterator tmp = *this;
+			--*this;
+			return tmp;
+		}
+
+		const value_type & operator*() const { return *leaf->slot(i); }
+		const value_type * operator->() const noexcept { return leaf->slot(i); }
+
+		bool operator==(const iterator &rhs) const {
+			return mp_belong == rhs.mp_belong && leaf == rhs.leaf && i == rhs.i;
+		}
+		bool operator==(const const_iterator &rhs) const {
+			return mp_belong == rhs.mp_belong && leaf == rhs.leaf && i == rhs.i;
+		}
+		bool operator!=(const iterator &rhs) const { return !(*this == rhs); }
+		bool operator!=(const const_iterator &rhs) const { return !(*this == rhs); }
+	};
+
+private:
+	// past the end of a leaf is the start of the next one.
+	iterator make_iterator(leaf_node *l, size_t i) {
+		if (i == l->n) {
+			l = l->next;
+			i = 0;
+		}
+		return iterator(this, l, i);
+	}
+	const_iterator make_iterator(leaf_node *l, size_t i) const {
+		if (i == l->n) {
+			l = l->next;
+			i = 0;
+		}
+		return const_iterator(this, l, i);
+	}
+
+public:
+	btree_map() : btree_map(Compare()) {}
+
+	explicit btree_map(const Compare &c, const Allocator &a = Allocator()) :
+		compare_holder<Compare>(c), alloc(a) { init_empty(); }
+
+	template <class InputIt>
+	btree_map(InputIt first, InputIt last, const Compare &c = Compare(), const Allocator &a = Allocator()) :
+		btree_map(c, a) {
+		for (; first != last; ++first) insert(*first);
+	}
+
+	btree_map(const btree_map &other) : compare_holder<Compare>(other.comp()),
+		alloc(alloc_traits::select_on_container_copy_construction(other.alloc)) {
+		copy_from(other);
+	}
+
+	btree_map & operator=(const btree_map &other) {
+		if (this != &other) {
+			free_tree(root, height);
+			comp() = other.comp();
+			copy_from(other);
+		}
+		return *this;
+	}
+
+	~btree_map() {
+		free_tree(root, height);
+	}
+
+	T & at(const Key &key) {
+		leaf_node *l;
+		size_t i;
+		if (tree_find(key, l, i)) return l->slot(i)->second;
+		throw index_out_of_bound();
+	}
+	const T & at(const Key &key) const {
+		leaf_node *l;
+		size_t i;
+		if (tree_find(key, l, i)) return l->slot(i)->second;
+		throw index_out_of_bound();
+	}
+
+	T & operator[](const Key &key) {
+		bool inserted;
+		pair<leaf_node*, size_t> pos = tree_get_or_emplace(key, inserted, std::piecewise_construct,
+			std::forward_as_tuple(key), std::tuple<>());
+		return pos.first->slot(pos.second)->second;
+	}
+
+	// with SJTU_UNCHECKED defined, a missing key is undefined behaviour
+	// instead of a throw.
+	const T & operator[](const Key &key) const {
+		leaf_node *l;
+		size_t i;
+		bool found = tree_find(key, l, i);
+#ifndef SJTU_UNCHECKED
+		if (!found) throw index_out_of_bound();
+#endif
+		(void)found;
+		return l->slot(i)->second;
+	}
+
+	T * try_at(const Key &key) {
+		leaf_node *l;
+		size_t i;
+		return tree_find(key, l, i) ? &l->slot(i)->second : nullptr;
+	}
+	const T * try_at(const Key &key) const {
+		leaf_node *l;
+		size_t i;
+		return tree_find(key, l, i) ? &l->slot(i)->second : nullptr;
+	}
+
+	iterator begin() { return tree_size ? iterator(this, leftmost, 0) : end(); }
+	const_iterator cbegin() const { return tree_size ? const_iterator(this, leftmost, 0) : cend(); }
+	iterator end() { return iterator(this, nullptr, 0); }
+	const_iterator cend() const { return const_iterator(this, nullptr, 0); }
+
+	allocator_type get_allocator() const { return alloc; }
+	key_compare key_comp() const { return comp(); }
+
+	bool empty() const { return tree_size == 0; }
+	size_t size() const { return tree_size; }
+	size_t count(const Key &key) const {
+		leaf_node *l;
+		size_t i;
+		return tree_find(key, l, i) ? 1 : 0;
+	}
+
+	void clear() {
+		free_tree(root, height);
+		init_empty();
+	}
+
+	pair<iterator, bool> insert(const value_type &value) {
+		bool inserted;
+		pair<leaf_node*, size_t> pos = tree_get_or_emplace(value.first, inserted, value);
+		return pair<iterator, bool>(iterator(this, pos.first, pos.second), inserted);
+	}
+
+	pair<iterator, bool> insert(value_type &&value) {
+		bool inserted;
+		pair<leaf_node*, size_t> pos = tree_get_or_emplace(value.first, inserted, std::move(value));
+		return pair<iterator, bool>(iterator(this, pos.first, pos.second), inserted);
+	}
+
+	// the value is built before the lookup, as the key comes from it.
+	template <class... Args>
+	pair<iterator, bool> emplace(Args&&... args) {
+		value_type value(std::forward<Args>(args)...);
+		return insert(std::move(value));
+	}
+
+	// nothing is constructed when key is already there.
+	template <class... Args>
+	pair<iterator, bool> try_emplace(const Key &key, Args&&... args) {
+		bool inserted;
+		pair<leaf_node*, size_t> pos = tree_get_or_emplace(key, inserted, std::piecewise_construct,
+			std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+		return pair<iterator, bool>(iterator(this, pos.first, pos.second), inserted);
+	}
+
+	template <class M>
+	pair<iterator, bool> insert_or_assign(const Key &key, M &&obj) {
+		leaf_node *l;
+		size_t i;
+		if (tree_find(key, l, i)) {
+			l->slot(i)->second = std::forward<M>(obj);
+			return pair<iterator, bool>(iterator(this, l, i), false);
+		}
+		bool inserted;
+		pair<leaf_node*, size_t> pos = tree_get_or_emplace(key, inserted, key, std::forward<M>(obj));
+		return pair<iterator, bool>(iterator(this, pos.first, pos.second), inserted);
+	}
+
+	void erase(iterator pos) {
+		if (pos.mp_belong != this || !pos.leaf || pos.i >= pos.leaf->n)
+			throw invalid_iterator();
+		tree_erase(pos.leaf, pos.i);
+	}
+
+	iterator find(const Key &key) {
+		leaf_node *l;
+		size_t i;
+		return tree_find(key, l, i) ? iterator(this, l, i) : end();
+	}
+	const_iterator find(const Key &key) const {
+		leaf_node *l;
+		size_t i;
+		return tree_find(key, l, i) ? const_iterator(this, l, i) : cend();
+	}
+
+	iterator lower_bound(const Key &key) {
+		leaf_node *l = descend(key);
+		return make_iterator(l, leaf_lower(l, key));
+	}
+	const_iterator lower_bound(const Key &key) const {
+		leaf_node *l = descend(key);
+		return make_iterator(l, leaf_lower(l, key));
+	}
+
+	iterator upper_bound(const Key &key) {
+		leaf_node *l = descend(key);
+		size_t i = leaf_lower(l, key);
+		if (i < l->n && !comp()(key, l->key(i))) ++i;
+		return make_iterator(l, i);
+	}
+	const_iterator upper_bound(const Key &key) const {
+		leaf_node *l = descend(key);
+		size_t i = leaf_lower(l, key);
+		if (i < l->n && !comp()(key, l->key(i))) ++i;
+		return make_iterator(l, i);
+	}
+
+	pair<iterator, iterator> equal_range(const Key &key) {
+		return pair<iterator, iterator>(lower_bound(key), upper_bound(key));
+	}
+	pair<const_iterator, const_iterator> equal_range(const Key &key) const {
+		return pair<const_iterator, const_iterator>(lower_bound(key), upper_bound(key));
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,256 @@
+#ifndef SJTU_CONCURRENT_MAP_HPP
+#define SJTU_CONCURRENT_MAP_HPP
+
+#include <functional>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include "map.hpp"
+
+namespace sjtu {
+
+// a map shared by many threads: keys are spread over shards by hash, and
+// every shard is a map behind its own reader-writer lock, so that
+// threads working on different shards do not wait for each other.
+// lookups return copies, as no reference outlives the lock.
+template<
+	class Key,
+	class T,
+	class Compare = std::less<Key>,
+	class Hash = std::hash<Key>,
+	class Allocator = std::allocator<pair<const Key, T>>
+> class concurrent_map {
+public:
+	using value_type = pair<const Key, T>;
+	using allocator_type = Allocator;
+	using key_compare = Compare;
+	using hasher = Hash;
+private:
+	using shard_map = map<Key, T, Compare, Allocator>;
+
+	// one per cache line, so that the locks do not share lines.
+	struct alignas(64) shard {
+		mutable std::shared_mutex lock;
+		shard_map data;
+		shard(const Compare &c, const Allocator &a): data(c, a) {}
+	};
+
+	std::vector<std::unique_ptr<shard>> shards;
+	size_t mask;
+	Hash hash;
+	Compare comp;
+
+	// std::hash of an integer is often the integer itself; mix it so that
+	// the high bits pick the shard.
+	size_t shard_of(const Key &key) const {
+		unsigned long long h = (unsigned long long)hash(key) * 0x9E3779B97F4A7C15ull;
+		return (size_t)(h >> 32) & mask;
+	}
+
+	static size_t default_shards() {
+		size_t n = std::thread::hardware_concurrency() * 4;
+		return n ? n : 16;
+	}
+
+	// indices of [0, n) grouped by shard; the group of shard s is
+	// [start[s], start[s + 1]).
+	template <class KeyOf>
+	void group(size_t n, KeyOf key_of, std::vector<size_t> &order, std::vector<size_t> &start) const {
+		std::vector<size_t> which(n);
+		start.assign(shards.size() + 1, 0);
+		for (size_t i = 0; i < n; ++i) {
+			which[i] = shard_of(key_of(i));
+			++start[which[i] + 1];
+		}
+		for (size_t s = 0; s < shards.size(); ++s) start[s + 1] += start[s];
+		order.resize(n);
+		std::vector<size_t> next(start.begin(), start.end() - 1);
+		for (size_t i = 0; i < n; ++i) order[next[which[i]]++] = i;
+	}
+
+public:
+	// n_shards is rounded up to a power of two.
+	explicit concurrent_map(size_t n_shards = default_shards(), const Compare &c = Compare(),
+		const Hash &h = Hash(), const Allocator &a = Allocator()) : hash(h), comp(c) {
+		size_t n = 1;
+		while (n < n_shards) n <<= 1;
+		mask = n - 1;
+		shards.reserve(n);
+		for (size_t i = 0; i < n; ++i) shards.emplace_back(new shard(c, a));
+	}
+
+	concurrent_map(const concurrent_map &) = delete;
+	concurrent_map & operator=(const concurrent_map &) = delete;
+
+	size_t shard_count() const { return shards.size(); }
+
+	// copy the value of key into value.
+	bool find(const Key &key, T &value) const {
+		const shard &s = *shards[shard_of(key)];
+		std::shared_lock<std::shared_mutex> guard(s.lock);
+		const T *p = s.data.try_at(key);
+		if (!p) return false;
+		value = *p;
+		return true;
+	}
+
+	size_t count(const Key &key) const {
+		const shard &s = *shards[shard_of(key)];
+		std::shared_lock<std::shared_mutex> guard(s.lock);
+		return s.data.count(key);
+	}
+
+	// call f(value) under the lock of the shard of key, if key is there.
+	template <class F>
+	bool visit(const Key &key, F f) {
+		shard &s = *shards[shard_of(key)];
+		std::unique_lock<std::shared_mutex> guard(s.lock);
+		T *p = s.data.try_at(key);
+		if (!p) return false;
+		f(*p);
+		return true;
+	}
+
+	bool insert(const value_type &value) {
+		shard &s = *shards[shard_of(value.first)];
+		std::unique_lock<std::shared_mutex> guard(s.lock);
+		return s.data.insert(value).second;
+	}
+
+	bool insert(const Key &key, const T &value) {
+		return insert(value_type(key, value));
+	}
+
+	template <class M>
+	bool insert_or_assign(const Key &key, M &&obj) {
+		shard &s = *shards[shard_of(key)];
+		std::unique_lock<std::shared_mutex> guard(s.lock);
+		return s.data.insert_or_assign(key, std::forward<M>(obj)).second;
+	}
+
+	size_t erase(const Key &key) {
+		shard &s = *shards[shard_of(key)];
+		std::unique_lock<std::shared_mutex> guard(s.lock);
+		return s.data.erase(key);
+	}
+
+	// the batched operations take the lock of every shard once.
+
+	// found[i] tells whether keys[i] is there, and then values[i] is its
+	// value. return the number found.
+	size_t find_batch(const Key *keys, size_t n, T *values, bool *found) const {
+		std::vector<size_t> order, start;
+		group(n, [keys](size_t i) -> const Key & { return keys[i]; }, order, start);
+		size_t hits = 0;
+		for (size_t s = 0; s < shards.size(); ++s) {
+			if (start[s] == start[s + 1]) continue;
+			std::shared_lock<std::shared_mutex> guard(shards[s]->lock);
+			for (size_t j = start[s]; j < start[s + 1]; ++j) {
+				size_t i = order[j];
+				const T *p = shards[s]->data.try_at(keys[i]);
+				found[i] = p != nullptr;
+				if (p) {
+					values[i] = *p;
+					++hits;
+				}
+			}
+		}
+		return hits;
+	}
+
+	// return the number inserted.
+	size_t insert_batch(const value_type *values, size_t n) {
+		std::vector<size_t> order, start;
+		group(n, [values](size_t i) -> const Key & { return values[i].first; }, order, start);
+		size_t added = 0;
+		for (size_t s = 0; s < shards.size(); ++s) {
+			if (start[s] == start[s + 1]) continue;
+			std::unique_lock<std::shared_mutex> guard(shards[s]->lock);
+			for (size_t j = start[s]; j < start[s + 1]; ++j) {
+				added += shards[s]->data.insert(values[order[j]]).second;
+			}
+		}
+		return added;
+	}
+
+	// return the number erased.
+	size_t erase_batch(const Key *keys, size_t n) {
+		std::vector<size_t> order, start;
+		group(n, [keys](size_t i) -> const Key & { return keys[i]; }, order, start);
+		size_t erased = 0;
+		for (size_t s = 0; s < shards.size(); ++s) {
+			if (start[s] == start[s + 1]) continue;
+			std::unique_lock<std::shared_mutex> guard(shards[s]->lock);
+			for (size_t j = start[s]; j < start[s + 1]; ++j) {
+				erased += shards[s]->data.erase(keys[order[j]]);
+			}
+		}
+		return erased;
+	}
+
+	// call f(value) on every element, one shard at a time, in no order.
+	// f must not call back into this map.
+	template <class F>
+	void for_each(F f) const {
+		for (const std::unique_ptr<shard> &s : shards) {
+			std::shared_lock<std::shared_mutex> guard(s->lock);
+			for (auto it = s->data.cbegin(); it != s->data.cend(); ++it) f(*it);
+		}
+	}
+
+	// call f(value) on every element in key order, merging the shards.
+	// every shard is locked for reading meanwhile, so this sees one state
+	// of the map and holds up writers until it returns.
+	template <class F>
+	void for_each_ordered(F f) const {
+		using cursor = std::pair<typename shard_map::const_iterator, typename shard_map::const_iterator>;
+		std::vector<std::shared_lock<std::shared_mutex>> guards;
+		guards.reserve(shards.size());
+		// always in shard order, so that two of these cannot deadlock.
+		for (const std::unique_ptr<shard> &s : shards) guards.emplace_back(s->lock);
+		std::vector<cursor> heap;
+		for (const std::unique_ptr<shard> &s : shards) {
+			if (!s->data.empty()) heap.push_back(cursor(s->data.cbegin(), s->data.cend()));
+		}
+		const Compare &c = comp;
+		auto later = [&c](const cursor &a, const cursor &b) { return c(b.first->first, a.first->first); };
+		std::make_heap(heap.begin(), heap.end(), later);
+		while (!heap.empty()) {
+			std::pop_heap(heap.begin(), heap.end(), later);
+			cursor &top = heap.back();
+			f(*top.first);
+			if (++top.first == top.second) {
+				heap.pop_back();
+			} else {
+				std::push_heap(heap.begin(), heap.end(), later);
+			}
+		}
+	}
+
+	// exact only while no other thread changes the map.
+	size_t size() const {
+		size_t n = 0;
+		for (const std::unique_ptr<shard> &s : shards) {
+			std::shared_lock<std::shared_mutex> guard(s->lock);
+			n += s->data.size();
+		}
+		return n;
+	}
+
+	bool empty() const { return size() == 0; }
+
+	void clear() {
+		for (const std::unique_ptr<shard> &s : shards) {
+			std::unique_lock<std::shared_mutex> guard(s->lock);
+			s->data.clear();
+		}
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,283 @@
+#ifndef SJTU_FLAT_MAP_HPP
+#define SJTU_FLAT_MAP_HPP
+
+#include <functional>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include <algorithm>
+#include "map.hpp"
+#include "simd.hpp"
+
+namespace sjtu {
+
+// a map that is built once and only read afterwards: the keys and the
+// values sit in two sorted arrays, so a lookup touches no pointers and the
+// keys of the last few steps share cache lines.
+// with std::less on int32, int64, float or double keys, the search halves
+// the range down to a few cache lines and then compares a whole vector of
+// keys at a time.
+// the keys cannot change; the values can be assigned through at() and the
+// iterators.
+template<
+	class Key,
+	class T,
+	class Compare = std::less<Key>,
+	class Allocator = std::allocator<pair<const Key, T>>
+> class flat_map : private compare_holder<Compare> {
+public:
+	using value_type = pair<const Key, T>;
+	using reference = pair<const Key &, T &>;
+	using const_reference = pair<const Key &, const T &>;
+	using allocator_type = Allocator;
+	using key_compare = Compare;
+private:
+	using compare_holder<Compare>::comp;
+
+	using alloc_traits = std::allocator_traits<Allocator>;
+	using key_allocator = typename alloc_traits::template rebind_alloc<Key>;
+	using mapped_allocator = typename alloc_traits::template rebind_alloc<T>;
+	using value_allocator = typename alloc_traits::template rebind_alloc<value_type>;
+	using pointer_allocator = typename alloc_traits::template rebind_alloc<const value_type*>;
+
+	std::vector<Key, key_allocator> keys;
+	std::vector<T, mapped_allocator> values;
+
+	// the vector kernels order keys by operator<, so they stand in for
+	// the comparator only when that is std::less.
+	static constexpr bool vector_search = simd::kind<Key>::value != 0 &&
+		(std::is_same<Compare, std::less<Key>>::value || std::is_same<Compare, std::less<>>::value);
+	using search_tag = std::integral_constant<int, vector_search ? simd::tag<Key>::value : 0>;
+
+	// the halving stops at about this many bytes of keys.
+	static constexpr size_t scan_bytes = 256;
+	static constexpr size_t scan = scan_bytes / sizeof(Key) > 8 ? scan_bytes / sizeof(Key) : 8;
+
+	// the first index whose key is not less than key. the halving keeps
+	// the answer in [base, base + n] and has no branch to mispredict.
+	size_t key_lower(const Key &key, std::integral_constant<int, 0>) const {
+		const Key *base = keys.data();
+		size_t n = keys.size();
+		while (n > 1) {
+			size_t half = n / 2;
+			base = comp()(base[half], key) ? base + half : base;
+			n -= half;
+		}
+		return (base - keys.data()) + (n && comp()(*base, key));
+	}
+	template <int K>
+	size_t key_lower(const Key &key, std::integral_constant<int, K>) const {
+		const Key *base = keys.data();
+		size_t n = keys.size();
+		while (n > scan) {
+			size_t half = n / 2;
+			base = base[half] < key ? base + half : base;
+			n -= half;
+		}
+		return (base - keys.data()) + simd::count_less(base, n, key, simd::tag<Key>());
+	}
+	size_t key_lower(const Key &key) const { return key_lower(key, search_tag()); }
+
+	size_t key_upper(const Key &key) const {
+		size_t i = key_lower(key);
+		return i < keys.size() && !comp()(key, keys[i]) ? i + 1 : i;
+	}
+
+	// the index of key, or size() when it is not there.
+	size_t key_find(const Key &key) const {
+		size_t i = key_lower(key);
+		return i < keys.size() && !comp()(key, keys[i]) ? i : keys.size();
+	}
+
+public:
+	class const_iterator;
+	class iterator {
+		friend class flat_map;
+		flat_map *mp_belong;
+		size_t i;
+		iterator(flat_map *mp_belong, size_t i) : mp_belong(mp_belong), i(i) {}
+	public:
+		// the element is made up on the fly, so -> points into this.
+		struct pointer {
+			reference ref;
+			const reference * operator->() const { return &ref; }
+		};
+
+		iterator() : mp_belong(nullptr), i(0) {}
+
+		iterator & operator++() {
+			if (!mp_belong || i >= mp_belong->size()) throw invalid_iterator();
+			++i;
+			return *this;
+		}
+		iterator operator++(int) {
+			iterator tmp = *this;
+			++*this;
+			return tmp;
+		}
+
+		iterator & operator--() {
+			if (!mp_belong || i == 0) throw invalid_iterator();
+			--i;
+			return *this;
+		}
+		iterator operator--(int) {
+			iterator tmp = *this;
+			--*this;
+			return tmp;
+		}
+
+		reference operator*() const { return reference(mp_belong->keys[i], mp_belong->values[i]); }
+		pointer operator->() const { return pointer{**this}; }
+
+		bool operator==(const iterator &rhs) const { return mp_belong == rhs.mp_belong && i == rhs.i; }
+		bool operator==(const const_iterator &rhs) const { return mp_belong == rhs.mp_belong && i == rhs.i; }
+		bool operator!=(const iterator &rhs) const { return !(*this == rhs); }
+		bool operator!=(const const_iterator &rhs) const { return !(*this == rhs); }
+	};
+	class const_iterator {
+		friend class flat_map;
+		const flat_map *mp_belong;
+		size_t i;
+		const_iterator(const flat_map *mp_belong, size_t i) : mp_belong(mp_belong), i(i) {}
+	public:
+		struct pointer {
+			const_reference ref;
+			const const_reference * operator->() const { return &ref; }
+		};
+
+		const_iterator() : mp_belong(nullptr), i(0) {}
+		const_iterator(const iterator &other) : mp_belong(other.mp_belong), i(other.i) {}
+
+		const_iterator & operator++() {
+			if (!mp_belong || i >= mp_belong->size()) throw invalid_iterator();
+			++i;
+			return *this;
+		}
+		const_iterator operator++(int) {
+			const_iterator tmp = *this;
+			++*this;
+			return tmp;
+		}
+
+		const_iterator & operator--() {
+			if (!mp_belong || i == 0) throw invalid_iterator();
+			--i;
+			return *this;
+		}
+		const_iterator operator--(int) {
+			const_iterator tmp = *this;
+			--*this;
+			return tmp;
+		}
+
+		const_reference operator*() const { return const_reference(mp_belong->keys[i], mp_belong->values[i]); }
+		pointer operator->() const { return pointer{**this}; }
+
+		bool operator==(const iterator &rhs) const { return mp_belong == rhs.mp_belong && i == rhs.i; }
+		bool operator==(const const_iterator &rhs) const { return mp_belong == rhs.mp_belong && i == rhs.i; }
+		bool operator!=(const iterator &rhs) const { return !(*this == rhs); }
+		bool operator!=(const const_iterator &rhs) const { return !(*this == rhs); }
+	};
+
+	explicit flat_map(const Compare &c = Compare(), const Allocator &a = Allocator()) :
+		compare_holder<Compare>(c), keys(key_allocator(a)), values(mapped_allocator(a)) {}
+
+	// one walk over m, which is sorted already.
+	template <class MapAllocator, class Augment>
+	explicit flat_map(const map<Key, T, Compare, MapAllocator, Augment> &m, const Allocator &a = Allocator()) :
+		flat_map(m.key_comp(), a) {
+		keys.reserve(m.size());
+		values.reserve(m.size());
+		for (auto it = m.cbegin(); it != m.cend(); ++it) {
+			keys.push_back(it->first);
+			values.push_back(it->second);
+		}
+	}
+
+	// of equal keys the first one is kept, as map::insert would.
+	template <class InputIt>
+	flat_map(InputIt first, InputIt last, const Compare &c = Compare(), const Allocator &a = Allocator()) :
+		flat_map(c, a) {
+		std::vector<value_type, value_allocator> all(first, last, value_allocator(a));
+		std::vector<const value_type*, pointer_allocator> order{pointer_allocator(a)};
+		order.reserve(all.size());
+		for (const value_type &v : all) order.push_back(&v);
+		const Compare &cmp = comp();
+		std::stable_sort(order.begin(), order.end(), [&cmp](const value_type *a, const value_type *b) {
+			return cmp(a->first, b->first);
+		});
+		order.erase(std::unique(order.begin(), order.end(), [&cmp](const value_type *a, const value_type *b) {
+			return !cmp(a->first, b->first) && !cmp(b->first, a->first);
+		}), order.end());
+		keys.reserve(order.size());
+		values.reserve(order.size());
+		for (const value_type *v : order) {
+			keys.push_back(v->first);
+			values.push_back(v->second);
+		}
+	}
+
+	T & at(const Key &key) {
+		size_t i = key_find(key);
+		if (i == keys.size()) throw index_out_of_bound();
+		return values[i];
+	}
+	const T & at(const Key &key) const {
+		size_t i = key_find(key);
+		if (i == keys.size()) throw index_out_of_bound();
+		return values[i];
+	}
+
+	// with SJTU_UNCHECKED defined, a missing key is undefined behaviour
+	// instead of a throw.
+	const T & operator[](const Key &key) const {
+		size_t i = key_find(key);
+#ifndef SJTU_UNCHECKED
+		if (i == keys.size()) throw index_out_of_bound();
+#endif
+		return values[i];
+	}
+
+	T * try_at(const Key &key) {
+		size_t i = key_find(key);
+		return i == keys.size() ? nullptr : &values[i];
+	}
+	const T * try_at(const Key &key) const {
+		size_t i = key_find(key);
+		return i == keys.size() ? nullptr : &values[i];
+	}
+
+	iterator begin() { return iterator(this, 0); }
+	const_iterator cbegin() const { return const_iterator(this, 0); }
+	iterator end() { return iterator(this, keys.size()); }
+	const_iterator cend() const { return const_iterator(this, keys.size()); }
+
+	allocator_type get_allocator() const { return allocator_type(keys.get_allocator()); }
+	key_compare key_comp() const { return comp(); }
+
+	bool empty() const { return keys.empty(); }
+	size_t size() const { return keys.size(); }
+	size_t count(const Key &key) const { return key_find(key) == keys.size() ? 0 : 1; }
+
+	iterator find(const Key &key) { return iterator(this, key_find(key)); }
+	const_iterator find(const Key &key) const { return const_iterator(this, key_find(key)); }
+
+	iterator lower_bound(const Key &key) { return iterator(this, key_lower(key)); }
+	const_iterator lower_bound(const Key &key) const { return const_iterator(this, key_lower(key)); }
+
+	iterator upper_bound(const Key &key) { return iterator(this, key_upper(key)); }
+	const_iterator upper_bound(const Key &key) const { return const_iterator(this, key_upper(key)); }
+
+	pair<iterator, iterator> equal_range(const Key &key) {
+		return pair<iterator, iterator>(lower_bound(key), upper_bound(key));
+	}
+	pair<const_iterator, const_iterator> equal_range(const Key &key) const {
+		return pair<const_iterator, const_iterator>(lower_bound(key), upper_bound(key));
+	}
+};
+
+}
+
+#endif
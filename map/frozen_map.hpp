@@ -0,0 +1,183 @@
+#ifndef SJTU_FROZEN_MAP_HPP
+#define SJTU_FROZEN_MAP_HPP
+
+#include <functional>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "map.hpp"
+
+namespace sjtu {
+
+// a snapshot of a map for lookups only, made by map::freeze().
+// the keys are laid out in Eytzinger (BFS) order: the children of slot k
+// are 2k and 2k + 1, so the first levels of every search share a few
+// cache lines and the next levels can be prefetched before they are
+// needed. the search has no branch on the comparison.
+// the elements themselves stay in key order for iteration; rank maps a
+// slot to its element.
+template<
+	class Key,
+	class T,
+	class Compare = std::less<Key>,
+	class Allocator = std::allocator<pair<const Key, T>>
+> class frozen_map : private compare_holder<Compare> {
+public:
+	using value_type = pair<const Key, T>;
+	using allocator_type = Allocator;
+	using key_compare = Compare;
+private:
+	using compare_holder<Compare>::comp;
+
+	using alloc_traits = std::allocator_traits<Allocator>;
+	using key_allocator = typename alloc_traits::template rebind_alloc<Key>;
+	using rank_allocator = typename alloc_traits::template rebind_alloc<size_t>;
+
+	// slot k (from 1) is keys[k - 1].
+	std::vector<Key, key_allocator> keys;
+	std::vector<size_t, rank_allocator> rank;
+	std::vector<value_type, Allocator> elements;
+
+	// the slots 4 levels below k start at 16k. with keys of a quarter
+	// cache line or less, those are one line, fetched while the search
+	// does the 4 levels in between.
+	static constexpr size_t prefetch_stride = 64 / sizeof(Key) >= 16 ? 16 : 64 / sizeof(Key) >= 4 ? 4 : 0;
+
+	// number the slots of the subtree at k in order, from next on.
+	size_t number(size_t k, size_t next) {
+		if (k > elements.size()) return next;
+		next = number(2 * k, next);
+		rank[k - 1] = next++;
+		return number(2 * k + 1, next);
+	}
+
+	void build() {
+		size_t n = elements.size();
+		keys.reserve(n);
+		rank.assign(n, 0);
+		number(1, 0);
+		for (size_t k = 0; k < n; ++k) keys.push_back(elements[rank[k]].first);
+	}
+
+	// the slot of the first key not less than key, 0 when there is none.
+	// the path taken is the bits of k; the answer is where the search went
+	// left for the last time.
+	size_t slot_lower(const Key &key) const {
+		const Key *e = keys.data();
+		size_t n = keys.size(), k = 1;
+		while (k <= n) {
+			if (prefetch_stride) __builtin_prefetch(e + (k * prefetch_stride - 1));
+			k = 2 * k + (size_t)comp()(e[k - 1], key);
+		}
+		return k >> __builtin_ffsll((long long)~k);
+	}
+
+	size_t key_lower(const Key &key) const {
+		size_t k = slot_lower(key);
+		return k ? rank[k - 1] : elements.size();
+	}
+
+	size_t key_find(const Key &key) const {
+		size_t k = slot_lower(key);
+		return k && !comp()(key, keys[k - 1]) ? rank[k - 1] : elements.size();
+	}
+
+	size_t key_upper(const Key &key) const {
+		size_t k = slot_lower(key);
+		if (!k) return elements.size();
+		return comp()(key, keys[k - 1]) ? rank[k - 1] : rank[k - 1] + 1;
+	}
+
+public:
+	class const_iterator {
+		friend class frozen_map;
+		const frozen_map *mp_belong;
+		size_t i;
+		const_iterator(const frozen_map *mp_belong, size_t i) : mp_belong(mp_belong), i(i) {}
+	public:
+		const_iterator() : mp_belong(nullptr), i(0) {}
+
+		const_iterator & operator++() {
+			if (!mp_belong || i >= mp_belong->size()) throw invalid_iterator();
+			++i;
+			return *this;
+		}
+		const_iterator operator++(int) {
+			const_iterator tmp = *this;
+			++*this;
+			return tmp;
+		}
+
+		const_iterator & operator--() {
+			if (!mp_belong || i == 0) throw invalid_iterator();
+			--i;
+			return *this;
+		}
+		const_iterator operator--(int) {
+			const_iterator tmp = *this;
+			--*this;
+			return tmp;
+		}
+
+		const value_type & operator*() const { return mp_belong->elements[i]; }
+		const value_type * operator->() const noexcept { return &mp_belong->elements[i]; }
+
+		bool operator==(const const_iterator &rhs) const { return mp_belong == rhs.mp_belong && i == rhs.i; }
+		bool operator!=(const const_iterator &rhs) const { return !(*this == rhs); }
+	};
+	using iterator = const_iterator;
+
+	// the values of m in order, O(n).
+	template <class MapAllocator, class Augment>
+	explicit frozen_map(const map<Key, T, Compare, MapAllocator, Augment> &m, const Allocator &a = Allocator()) :
+		compare_holder<Compare>(m.key_comp()), keys(key_allocator(a)), rank(rank_allocator(a)), elements(a) {
+		elements.reserve(m.size());
+		for (auto it = m.cbegin(); it != m.cend(); ++it) elements.push_back(*it);
+		build();
+	}
+
+	const T & at(const Key &key) const {
+		size_t i = key_find(key);
+		if (i == elements.size()) throw index_out_of_bound();
+		return elements[i].second;
+	}
+
+	// with SJTU_UNCHECKED defined, a missing key is undefined behaviour
+	// instead of a throw.
+	const T & operator[](const Key &key) const {
+		size_t i = key_find(key);
+#ifndef SJTU_UNCHECKED
+		if (i == elements.size()) throw index_out_of_bound();
+#endif
+		return elements[i].second;
+	}
+
+	const T * try_at(const Key &key) const {
+		size_t i = key_find(key);
+		return i == elements.size() ? nullptr : &elements[i].second;
+	}
+
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator cbegin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, elements.size()); }
+	const_iterator cend() const { return const_iterator(this, elements.size()); }
+
+	allocator_type get_allocator() const { return elements.get_allocator(); }
+	key_compare key_comp() const { return comp(); }
+
+	bool empty() const { return elements.empty(); }
+	size_t size() const { return elements.size(); }
+	size_t count(const Key &key) const { return key_find(key) == elements.size() ? 0 : 1; }
+
+	const_iterator find(const Key &key) const { return const_iterator(this, key_find(key)); }
+	const_iterator lower_bound(const Key &key) const { return const_iterator(this, key_lower(key)); }
+	const_iterator upper_bound(const Key &key) const { return const_iterator(this, key_upper(key)); }
+
+	pair<const_iterator, const_iterator> equal_range(const Key &key) const {
+		return pair<const_iterator, const_iterator>(lower_bound(key), upper_bound(key));
+	}
+};
+
+}
+
+#endif
@@ -3,9 +3,44 @@
 
 #include <functional>
 #include <cstddef>
+#include <cstdint>
 #include <cassert>
+#include <memory>
+#include <type_traits>
+#include <tuple>
+#include <utility>
+#include <iterator>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <fstream>
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define SJTU_HAS_PMR
+#endif
+#endif
 #include "utility.hpp"
 #include "exceptions.hpp"
+#include "serializer.hpp"
+
+// with SJTU_MAP_MMAP defined, on a POSIX system, load_file maps a packed
+// file instead of reading it; see mapped_file.hpp.
+#ifdef SJTU_MAP_MMAP
+#include "mapped_file.hpp"
+#endif
+
+// with SJTU_MAP_STATS defined, map counts what it does; see map::stats().
+#ifdef SJTU_MAP_STATS
+#define SJTU_MAP_COUNT(field) (void)counters.field.fetch_add(1, std::memory_order_relaxed)
+#else
+#define SJTU_MAP_COUNT(field) (void)0
+#endif
 
 namespace sjtu {
 
@@ -20,15 +55,380 @@ template <class T1, class T2>
 pair<T1, T2> make_pair(const T1 &a, const T2 &b) {
 	return pair<T1, T2>(a, b);
 }
+
+// a slab of nodes owned by one container.
+// nodes are carved out of chunks by bumping a pointer; a freed node goes
+// to a free list and is handed out again before the chunk is bumped.
+// allocate() returns raw storage, the owner constructs and destroys
+// the Node in it.
+// a node may move to another container and be freed there, or by a node
+// handle (see release). each chunk counts its nodes that are out, and is
+// given back to the allocator on its own once its pool is gone and its
+// last node is freed: a node that moved keeps only its chunk alive.
+// while the pool lives, its nodes freed elsewhere come back to it.
+// a chunk is made of pages aligned to page_bytes, each starting with a
+// pointer to its chunk, so the chunk of a node is found from its address.
+template <class Node, class Allocator>
+class node_pool {
+	struct free_slot {
+		free_slot *next;
+	};
+	struct shared;
+	struct chunk {
+		// the nodes out, plus held while the pool lives.
+		std::atomic<size_t> refs;
+		// the nodes out as seen by the pool; only the pool touches it.
+		size_t out;
+		shared *home;
+		unsigned char *raw, *first;
+		size_t raw_bytes, pages;
+		chunk *next, *next_ahead;
+	};
+	// what the chunks of one pool share with each other.
+	struct shared {
+		// the chunks alive, plus one while the pool lives.
+		std::atomic<size_t> refs;
+		// nodes freed outside the pool, to be taken back by it.
+		std::atomic<free_slot*> returned;
+		Allocator alloc;
+		explicit shared(const Allocator &a): refs(1), returned(nullptr), alloc(a) {}
+	};
+
+	using byte_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<unsigned char>;
+	using byte_traits = std::allocator_traits<byte_allocator>;
+	using chunk_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<chunk>;
+	using chunk_traits = std::allocator_traits<chunk_allocator>;
+	using shared_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<shared>;
+	using shared_traits = std::allocator_traits<shared_allocator>;
+
+	static constexpr size_t page_header = (sizeof(chunk*) + alignof(Node) - 1) / alignof(Node) * alignof(Node);
+	static constexpr size_t fit_page(size_t bytes, size_t page) {
+		return page >= bytes ? page : fit_page(bytes, page * 2);
+	}
+	// at least 16 nodes a page.
+	static constexpr size_t page_bytes = fit_page(page_header + 16 * sizeof(Node), 1024);
+	static constexpr size_t per_page = (page_bytes - page_header) / sizeof(Node);
+	// a chunk is at most this many pages, so that a node that moved away
+	// keeps little memory alive.
+	static constexpr size_t max_pages = 16;
+	// refs of a chunk start at held; the pool takes back the part its
+	// nodes do not use when it goes.
+	static constexpr size_t held = (size_t)1 << (sizeof(size_t) * 8 - 2);
+
+	shared *sh;
+	// the chunks of this pool, the newest first. the ones from ahead on are
+	// reserved and not bumped into yet, the oldest first.
+	chunk *chunks, *cur, *ahead, *ahead_last;
+	Node *bump, *bump_end;
+	unsigned char *page_next;
+	free_slot *free_list;
+	size_t n_free, n_ahead, n_total;
+
+	static chunk * chunk_of(void *p) {
+		return *reinterpret_cast<chunk**>(reinterpret_cast<std::uintptr_t>(p) & ~(std::uintptr_t)(page_bytes - 1));
+	}
+
+	static void drop(shared *h) {
+		if (h->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+		shared_allocator sa(h->alloc);
+		h->~shared();
+		shared_traits::deallocate(sa, h, 1);
+	}
+
+	// take n off the refs of c; free it when none are left.
+	static void drop(chunk *c, size_t n) {
+		if (c->refs.fetch_sub(n, std::memory_order_acq_rel) != n) return;
+		shared *h = c->home;
+		byte_allocator ba(h->alloc);
+		chunk_allocator ca(h->alloc);
+		byte_traits::deallocate(ba, c->raw, c->raw_bytes);
+		c->~chunk();
+		chunk_traits::deallocate(ca, c, 1);
+		drop(h);
+	}
+
+	chunk * new_chunk(size_t pages) {
+		byte_allocator ba(sh->alloc);
+		chunk_allocator ca(sh->alloc);
+		chunk *c = chunk_traits::allocate(ca, 1);
+		size_t raw_bytes = pages * page_bytes + page_bytes - 1;
+		unsigned char *raw;
+		try {
+			raw = byte_traits::allocate(ba, raw_bytes);
+		} catch (...) {
+			chunk_traits::deallocate(ca, c, 1);
+			throw;
+		}
+		c = new (c) chunk{{held}, 0, sh, raw, nullptr, raw_bytes, pages, chunks, nullptr};
+		c->first = raw + ((page_bytes - reinterpret_cast<std::uintptr_t>(raw) % page_bytes) % page_bytes);
+		for (size_t i = 0; i < pages; ++i) new (c->first + i * page_bytes) chunk*(c);
+		chunks = c;
+		++sh->refs;
+		n_total += pages * per_page;
+		return c;
+	}
+
+	void open(chunk *c) {
+		cur = c;
+		page_next = c->first;
+	}
+
+	// move the bump to the next page, of a new chunk if need be.
+	void next_page() {
+		if (!cur || page_next == cur->first + cur->pages * page_bytes) {
+			if (ahead) {
+				chunk *c = ahead;
+				ahead = c->next_ahead;
+				n_ahead -= c->pages * per_page;
+				open(c);
+			} else {
+				size_t pages = n_total / per_page;
+				open(new_chunk(pages < 1 ? 1 : pages > max_pages ? max_pages : pages));
+			}
+		}
+		bump = reinterpret_cast<Node*>(page_next + page_header);
+		bump_end = bump + per_page;
+		page_next += page_bytes;
+	}
+
+	// take back the nodes freed outside the pool.
+	bool take_returned() {
+		if (!sh->returned.load(std::memory_order_relaxed)) return false;
+		free_slot *p = sh->returned.exchange(nullptr, std::memory_order_acquire);
+		while (p) {
+			free_slot *next = p->next;
+			chunk *c = chunk_of(p);
+			c->refs.fetch_add(1, std::memory_order_relaxed);
+			--c->out;
+			free_list = new (p) free_slot{free_list};
+			++n_free;
+			p = next;
+		}
+		return free_list != nullptr;
+	}
+
+public:
+	explicit node_pool(const Allocator &a): sh(nullptr), chunks(nullptr), cur(nullptr), ahead(nullptr), ahead_last(nullptr),
+		bump(nullptr), bump_end(nullptr), page_next(nullptr), free_list(nullptr), n_free(0), n_ahead(0), n_total(0) {
+		shared_allocator sa(a);
+		sh = new (shared_traits::allocate(sa, 1)) shared(a);
+	}
+
+	node_pool(const node_pool &) = delete;
+	node_pool & operator=(const node_pool &) = delete;
+
+	~node_pool() {
+		while (chunks) {
+			chunk *c = chunks;
+			chunks = c->next;
+			drop(c, held - c->out);
+		}
+		drop(sh);
+	}
+
+	void swap(node_pool &other) {
+		std::swap(sh, other.sh);
+		std::swap(chunks, other.chunks);
+		std::swap(cur, other.cur);
+		std::swap(ahead, other.ahead);
+		std::swap(ahead_last, other.ahead_last);
+		std::swap(bump, other.bump);
+		std::swap(bump_end, other.bump_end);
+		std::swap(page_next, other.page_next);
+		std::swap(free_list, other.free_list);
+		std::swap(n_free, other.n_free);
+		std::swap(n_ahead, other.n_ahead);
+		std::swap(n_total, other.n_total);
+	}
+
+	void *allocate() {
+		if (free_list || take_returned()) {
+			free_slot *p = free_list;
+			free_list = p->next;
+			--n_free;
+			p->~free_slot();
+			++chunk_of(p)->out;
+			return p;
+		}
+		if (bump == bump_end) next_page();
+		++cur->out;
+		return bump++;
+	}
+
+	// p must already be destroyed. it may come from another pool.
+	void deallocate(void *p) {
+		chunk *c = chunk_of(p);
+		if (c->home != sh) {
+			release(p);
+			return;
+		}
+		--c->out;
+		free_list = new (p) free_slot{free_list};
+		++n_free;
+	}
+
+	// free p, destroyed already, outside of any pool. safe to call from
+	// any thread, as long as p itself is not shared.
+	static void release(void *p) {
+		chunk *c = chunk_of(p);
+		shared *h = c->home;
+		free_slot *s = new (p) free_slot{h->returned.load(std::memory_order_relaxed)};
+		while (!h->returned.compare_exchange_weak(s->next, s, std::memory_order_release, std::memory_order_relaxed)) {}
+		drop(c, 1);
+	}
+
+	// make the next n allocate() calls take no memory from the allocator.
+	void reserve(size_t n) {
+		take_returned();
+		size_t room = n_free + (bump_end - bump) + n_ahead;
+		if (cur) room += (cur->first + cur->pages * page_bytes - page_next) / page_bytes * per_page;
+		while (room < n) {
+			size_t pages = (n - room + per_page - 1) / per_page;
+			chunk *c = new_chunk(pages > max_pages ? max_pages : pages);
+			if (ahead) ahead_last->next_ahead = c;
+			else ahead = c;
+			ahead_last = c;
+			n_ahead += c->pages * per_page;
+			room += c->pages * per_page;
+		}
+	}
+
+	// nodes handed out or ready to be handed out.
+	size_t capacity() const { return n_total; }
+};
+
+// the activity of a map since it was made or since reset_stats(). the
+// counters are only kept with SJTU_MAP_STATS defined, and read 0
+// otherwise; the sizes are always filled.
+struct map_stats {
+	size_t comparisons;
+	size_t rotations_left, rotations_right;
+	// iterations of the rebalance loops.
+	size_t insert_fixups, erase_fixups;
+	size_t node_allocations, node_frees;
+	size_t size;
+	// in the nodes of the elements and the header; memory the elements
+	// own themselves is not counted.
+	size_t bytes_in_use;
+	// in nodes carved from the allocator by this map, in use or not.
+	size_t bytes_reserved;
+};
+
+// the shape of the tree of a map, see map::tree_stats().
+struct map_tree_stats {
+	// nodes on the longest path from the root, 0 when empty.
+	size_t height = 0;
+	// black nodes on any path from the root down.
+	size_t black_height = 0;
+	// depth_count[d] nodes are d links below the root.
+	std::vector<size_t> depth_count;
+	// black_height_count[h] nodes have black height h, themselves counted.
+	std::vector<size_t> black_height_count;
+};
+
+// tag for constructors taking a range already sorted without duplicates.
+struct sorted_unique_t { explicit sorted_unique_t() = default; };
+constexpr sorted_unique_t sorted_unique{};
+
+// augmentations of map: every node keeps the aggregate of its subtree
+// under a monoid, recomputed from its children whenever the tree changes
+// shape. an augmentation is a stateless policy:
+//   using value_type = ...;                  the aggregate
+//   static value_type identity();
+//   static value_type combine(const value_type &, const value_type &);
+//   template <class V> static value_type lift(const V &);   of one element
+// combine must be associative; it need not be commutative.
+// a policy whose lift looks at the key only says so with
+//   static constexpr bool reads_mapped = false;
+// otherwise the mapped values of the map are read-only, except through
+// insert_or_assign() and modify(), so that no aggregate goes stale.
+struct no_augment {
+	static constexpr bool reads_mapped = false;
+};
+
+// subtree sizes, for select(), rank() and O(log n) distance().
+struct order_statistics {
+	static constexpr bool reads_mapped = false;
+	using value_type = size_t;
+	static size_t identity() { return 0; }
+	static size_t combine(size_t a, size_t b) { return a + b; }
+	template <class V>
+	static size_t lift(const V &) { return 1; }
+};
+
+// the extra data in a node. empty unless the map is augmented, so a
+// plain map's nodes are no bigger.
+template <class Augment>
+struct augment_data {
+	typename Augment::value_type agg = Augment::identity();
+};
+
+template <>
+struct augment_data<no_augment> {};
+
+template <class Augment, class = void>
+struct augment_reads_mapped : std::true_type {};
+
+template <class Augment>
+struct augment_reads_mapped<Augment, typename std::enable_if<!Augment::reads_mapped>::type> : std::false_type {};
+
+template <class Augment>
+struct augment_value {
+	using type = typename Augment::value_type;
+};
+
+template <>
+struct augment_value<no_augment> {
+	using type = void;
+};
+
+// holds the comparator of a container.
+// a stateless comparator is a base class, so it takes no room.
+template <class Compare, bool = std::is_empty<Compare>::value && !std::is_final<Compare>::value>
+class compare_holder : private Compare {
+public:
+	explicit compare_holder(const Compare &c) : Compare(c) {}
+	const Compare & comp() const { return *this; }
+	Compare & comp() { return *this; }
+};
+
+template <class Compare>
+class compare_holder<Compare, false> {
+	Compare c;
+public:
+	explicit compare_holder(const Compare &c) : c(c) {}
+	const Compare & comp() const { return c; }
+	Compare & comp() { return c; }
+};
+
+template <class Key, class T, class Compare, class Allocator>
+class frozen_map;
 	
+// tree nodes and values are allocated through Allocator.
+// the comparator is stored once; with Compare::is_transparent, find,
+// count and at also accept keys of other types.
+// with an Augment policy every node keeps the aggregate of its subtree;
+// order_statistics keeps subtree sizes.
 template<
 	class Key,
 	class T,
-	class Compare = std::less<Key>
-> class map {
+	class Compare = std::less<Key>,
+	class Allocator = std::allocator<pair<const Key, T>>,
+	class Augment = no_augment
+> class map : private compare_holder<Compare> {
 public:
 	using value_type = pair<const Key, T>;
+	using allocator_type = Allocator;
+	using key_compare = Compare;
+	using aggregate_type = typename augment_value<Augment>::type;
 private:
+	// what the iterators and at() give out: read-only when the aggregates
+	// depend on the mapped values.
+	using mapped_ref = typename std::conditional<augment_reads_mapped<Augment>::value, const T &, T &>::type;
+	using element_ref = typename std::conditional<augment_reads_mapped<Augment>::value, const value_type &, value_type &>::type;
+
+	using compare_holder<Compare>::comp;
+
 	friend class iterator;
 	friend class const_iterator;
 
@@ -39,46 +439,78 @@ private:
 
 	struct tree_node;
 
+	// recompute the aggregate of x from its children.
+	static void pull(tree_node *, no_augment) {}
+	template <class A>
+	static void pull(tree_node *x, A) {
+		x->agg = A::combine(A::combine(subtree_agg(x->left), A::lift(value_of(x))), subtree_agg(x->right));
+	}
+	static void pull(tree_node *x) { pull(x, Augment()); }
+
+	// pull every node from x up to (not including) top.
+	static void pull_path(tree_node *, tree_node *, no_augment) {}
+	template <class A>
+	static void pull_path(tree_node *x, tree_node *top, A) {
+		for (; x != top; x = x->parent()) pull(x);
+	}
+	void pull_path(tree_node *x) { pull_path(x, header, Augment()); }
+
+	template <class A = Augment>
+	static typename A::value_type subtree_agg(tree_node *x) { return x ? x->agg : A::identity(); }
+	static size_t subtree_size(tree_node *x) { return x ? x->agg : 0; }
+
 	void rot_right(tree_node *y) {
-		tree_node* x = y->left, *p = y->parent;
+		SJTU_MAP_COUNT(rotations_right);
+		tree_node* x = y->left, *p = y->parent();
 		y->left = x->right;
-		if (x->right) x->right->parent = y;
-		y->parent = x;
+		if (x->right) x->right->set_parent(y);
+		y->set_parent(x);
 		x->right = y;
-		x->parent = p;
-		if (y == p->parent) 
-			p->parent = x;
+		x->set_parent(p);
+		if (y == p->parent()) 
+			p->set_parent(x);
 		else if (y == p->left)   
 			p->left = x;
 		else if (y == p->right)  
 			p->right = x;
+		pull(y);
+		pull(x);
 	}
 
 	void rot_left(tree_node *x) {
-		tree_node* y = x->right, *p = x->parent;
+		SJTU_MAP_COUNT(rotations_left);
+		tree_node* y = x->right, *p = x->parent();
 		x->right = y->left;
-		if (y->left) y->left->parent = x;
-		x->parent = y;
+		if (y->left) y->left->set_parent(x);
+		x->set_parent(y);
 		y->left = x;
-		y->parent = p;
-		if (x == p->parent) 
-			p->parent = y;
+		y->set_parent(p);
+		if (x == p->parent()) 
+			p->set_parent(y);
 		else if (x == p->left)   
 			p->left = y;
 		else if (x == p->right)  
 			p->right = y;
+		pull(x);
+		pull(y);
 	}
 
-	void tree_insert_rebalance(tree_node *x) {
-		while (x != header->parent && x->parent->color == RED) {
-			tree_node *p = x->parent, *g = x->parent->parent;
+	void tree_insert_rebalance(tree_node *x) { tree_insert_rebalance(x, header); }
+
+	// top is the header of the tree x is in. return whether the root
+	// was red, so that the black height grew.
+	bool tree_insert_rebalance(tree_node *x, tree_node *top) {
+		while (x != top->parent() && x->parent()->color() == RED) {
+			SJTU_MAP_COUNT(insert_fixups);
+			tree_node *p = x->parent(), *g = x->parent()->parent();
 			if (p == g->left) {
 				// parent is grandparent's left.
 				tree_node *u = g->right;
-				if (u && u->color == RED) {
+				if (u && u->color() == RED) {
 					// uncle exists and color is RED.
-					u->color = p->color = BLACK;
-					g->color = RED;
+					u->set_color(BLACK);
+					p->set_color(BLACK);
+					g->set_color(RED);
 					x = g;
 				} else {
 					//uncle not exists or color is BLACK.
@@ -86,18 +518,19 @@ private:
 						x = p;
 						rot_left(x);
 					}
-					x->parent->color = BLACK;
-					x->parent->parent->color = RED;
-					rot_right(x->parent->parent);
+					x->parent()->set_color(BLACK);
+					x->parent()->parent()->set_color(RED);
+					rot_right(x->parent()->parent());
 				}
 			}
 			else {
 				// parent is grandparent's right.
 				tree_node *u = g->left;
-				if (u && u->color == RED) {
+				if (u && u->color() == RED) {
 					// uncle exists and color is RED.
-					u->color = p->color = BLACK;
-					g->color = RED;
+					u->set_color(BLACK);
+					p->set_color(BLACK);
+					g->set_color(RED);
 					x = g;
 				} else {
 					//uncle not exists or color is BLACK.
@@ -105,100 +538,197 @@ private:
 						x = p;
 						rot_right(x);
 					}
-					x->parent->color = BLACK;
-					x->parent->parent->color = RED;
-					rot_left(x->parent->parent);
+					x->parent()->set_color(BLACK);
+					x->parent()->parent()->set_color(RED);
+					rot_left(x->parent()->parent());
 				}
 			}
 		}
-		header->parent->color = BLACK;
+		bool grew = top->parent()->color() == RED;
+		top->parent()->set_color(BLACK);
+		return grew;
 	}
 
-	bool is_red(tree_node *x) { return x && x->color == RED; }
-	bool is_black(tree_node *x) { return !is_red(x); }
+	static bool is_red(tree_node *x) { return x && x->color() == RED; }
+	static bool is_black(tree_node *x) { return !is_red(x); }
 
 	void tree_delete_rebalance(tree_node *x, tree_node *parent) {
-		color_t color = x ? x->color : BLACK;
+		color_t color = x ? x->color() : BLACK;
 
-		while (x != header->parent && color == BLACK) {
+		while (x != header->parent() && color == BLACK) {
+			SJTU_MAP_COUNT(erase_fixups);
 			if (x == parent->left) {
 				tree_node *w = parent->right;
 				if (is_red(w)) {
-					w->color = BLACK;
-					parent->color = RED;
+					w->set_color(BLACK);
+					parent->set_color(RED);
 					rot_left(parent);
 					w = parent->right;
 				}
 				if (w && is_black(w->left) && is_black(w->right)) {
-					w->color = RED;
+					w->set_color(RED);
 					x = parent;
 				}
 				else {
 					if (w && is_black(w->right)) {
-						w->left->color = BLACK;
-						w->color = RED;
+						w->left->set_color(BLACK);
+						w->set_color(RED);
 						rot_right(w);
 						w = parent->right;
 					}
-					if (w) w->color = parent->color;
-					parent->color = BLACK;
-					if (w && w->right) w->right->color = BLACK;
+					if (w) w->set_color(parent->color());
+					parent->set_color(BLACK);
+					if (w && w->right) w->right->set_color(BLACK);
 					rot_left(parent);
-					x = header->parent;
+					x = header->parent();
 				}
 			}
 			else {
 				tree_node *w = parent->left;
-				if (w->color == RED) {
-					w->color = BLACK;
-					parent->color = RED;
+				if (w->color() == RED) {
+					w->set_color(BLACK);
+					parent->set_color(RED);
 					rot_right(parent);
 					w = parent->left;
 				}
 				if (w && is_black(w->right) && is_black(w->left)) {
-					w->color = RED;
+					w->set_color(RED);
 					x = parent;
 				}
 				else {
 					if (w && is_black(w->left)) {
-						w->right->color = BLACK;
-						w->color = RED;
+						w->right->set_color(BLACK);
+						w->set_color(RED);
 						rot_left(w);
 						w = parent->left;
 					}
-					if (w) w->color = parent->color;
-					parent->color = BLACK;
-					if (w && w->left) w->left->color = BLACK;
+					if (w) w->set_color(parent->color());
+					parent->set_color(BLACK);
+					if (w && w->left) w->left->set_color(BLACK);
 					rot_right(parent);
-					x = header->parent;
+					x = header->parent();
 				}
 			}
 			if (x) {
-				color = x->color;
-				parent = x->parent;
+				color = x->color();
+				parent = x->parent();
 			} else {
 				color = BLACK;
-				parent = header->parent;
+				parent = header->parent();
 			}
 			
 		}
-		if (x) x->color = BLACK;
+		if (x) x->set_color(BLACK);
 	}
 
-	struct tree_node {
-		value_type* v;
-		tree_node *left, *right, *parent;
-		color_t color;
-		tree_node(): left(nullptr), right(nullptr), parent(nullptr), v(nullptr), color(BLACK) {}
-		tree_node(const Key& key, const T& value, const color_t &color = BLACK, tree_node *p = nullptr, tree_node *l = nullptr, tree_node *r = nullptr):
-			v(new value_type(key, value)), left(l), right(r), color(color), parent(p) {}
-		~tree_node() {
-			if (v) delete v;
-		}
+	// the links of a node. the header is a bare tree_node.
+	// with SJTU_MAP_COMPACT the color is the low bit of the parent
+	// pointer, which nodes being aligned to pointers leaves clear; that
+	// saves a word per node.
+	struct tree_node : augment_data<Augment> {
+		tree_node *left, *right;
+#ifdef SJTU_MAP_COMPACT
+	private:
+		uintptr_t parent_color;
+	public:
+		tree_node(const color_t &color = BLACK, tree_node *p = nullptr, tree_node *l = nullptr, tree_node *r = nullptr):
+			left(l), right(r), parent_color(reinterpret_cast<uintptr_t>(p) | color) {}
+		tree_node* parent() const { return reinterpret_cast<tree_node*>(parent_color & ~uintptr_t(1)); }
+		color_t color() const { return color_t(parent_color & 1); }
+		void set_parent(tree_node *p) { parent_color = reinterpret_cast<uintptr_t>(p) | (parent_color & 1); }
+		void set_color(color_t c) { parent_color = (parent_color & ~uintptr_t(1)) | c; }
+#else
+	private:
+		tree_node *up;
+		color_t c;
+	public:
+		tree_node(const color_t &color = BLACK, tree_node *p = nullptr, tree_node *l = nullptr, tree_node *r = nullptr):
+			left(l), right(r), up(p), c(color) {}
+		tree_node* parent() const { return up; }
+		color_t color() const { return c; }
+		void set_parent(tree_node *p) { up = p; }
+		void set_color(color_t color) { c = color; }
+#endif
 	};
 
+	// a node with its value inline, one allocation per element.
+	// the value is constructed in place through the allocator.
+	struct value_node : tree_node {
+		alignas(value_type) unsigned char storage[sizeof(value_type)];
+		value_node(const color_t &color, tree_node *p): tree_node(color, p) {}
+		value_type* v() { return reinterpret_cast<value_type*>(storage); }
+	};
+
+	static value_type& value_of(tree_node *p) { return *static_cast<value_node*>(p)->v(); }
+	static const Key& key_of(tree_node *p) { return static_cast<value_node*>(p)->v()->first; }
+
+	using alloc_traits = std::allocator_traits<Allocator>;
+	using header_allocator = typename alloc_traits::template rebind_alloc<tree_node>;
+	using header_traits = std::allocator_traits<header_allocator>;
+	// for scratch space while building a tree.
+	using value_allocator = typename alloc_traits::template rebind_alloc<value_type>;
+	using pointer_allocator = typename alloc_traits::template rebind_alloc<const value_type*>;
+	using char_allocator = typename alloc_traits::template rebind_alloc<char>;
+
+	using pool_type = node_pool<value_node, Allocator>;
+
 	tree_node *header; 
 	size_t tree_size;
+	Allocator alloc;
+	pool_type pool;
+
+#ifdef SJTU_MAP_STATS
+	struct stat_counters {
+		std::atomic<size_t> comparisons{0}, rotations_left{0}, rotations_right{0},
+			insert_fixups{0}, erase_fixups{0}, node_allocations{0}, node_frees{0};
+	};
+	// atomic, as the parallel set operations count from several threads;
+	// mutable, as lookups count too.
+	mutable stat_counters counters;
+#endif
+
+	// count the subtree at x, on depth d, into s; return its black height.
+	size_t tree_shape(tree_node *x, size_t d, map_tree_stats &s) const {
+		if (!x) return 0;
+		if (s.depth_count.size() <= d) s.depth_count.resize(d + 1);
+		++s.depth_count[d];
+		size_t bh = tree_shape(x->left, d + 1, s) + (x->color() == BLACK);
+		tree_shape(x->right, d + 1, s);
+		if (s.black_height_count.size() <= bh) s.black_height_count.resize(bh + 1);
+		++s.black_height_count[bh];
+		return bh;
+	}
+
+	// every comparison of keys goes through here, to be counted.
+	template <class A, class B>
+	bool key_less(const A &a, const B &b) const {
+		SJTU_MAP_COUNT(comparisons);
+		return comp()(a, b);
+	}
+
+	// the value is constructed from args.
+	template <class... Args>
+	tree_node* create_node(const color_t &color, tree_node *p, Args&&... args) {
+		void *slot = pool.allocate();
+		value_node *node = new (slot) value_node(color, p);
+		try {
+			alloc_traits::construct(alloc, node->v(), std::forward<Args>(args)...);
+		} catch (...) {
+			node->~value_node();
+			pool.deallocate(slot);
+			throw;
+		}
+		SJTU_MAP_COUNT(node_allocations);
+		return node;
+	}
+
+	void destroy_node(tree_node *p) {
+		value_node *node = static_cast<value_node*>(p);
+		alloc_traits::destroy(alloc, node->v());
+		node->~value_node();
+		pool.deallocate(node);
+		SJTU_MAP_COUNT(node_frees);
+	}
 
 	tree_node* retrieve_succ(tree_node *p) const {
 		tree_node *q = p;
@@ -214,33 +744,92 @@ private:
 		return q;
 	}
 
-	pair<tree_node*, bool> tree_get_or_create(const Key& key) {
-		tree_node *p = header->parent, *parent = header;
-		bool from_left;
-
-        if (!p) {
-            auto new_node = new tree_node(key, T(), BLACK, parent);
-            header->parent = header->left = header->right = new_node;
-			tree_size++;
-			return make_pair(new_node, true);
-        }
-
+	// return the node of key, or nullptr and the place to link it.
+	template <class K>
+	tree_node* tree_find_slot(const K& key, tree_node *&parent, bool &from_left) const {
+		tree_node *p = header->parent();
+		parent = header;
+		from_left = true;
 		while (p) {
 			parent = p;
-			if (Compare()(key, p->v->first)) {
+			if (key_less(key, key_of(p))) {
 				p = p->left;
 				from_left = true;
 			}
-			else if (Compare()(p->v->first, key)) {
+			else if (key_less(key_of(p), key)) {
 				p = p->right;
 				from_left = false;
 			} else {
-				return make_pair(p, false);
+				return p;
 			}
 		}
+		return nullptr;
+	}
 
+	// like tree_find_slot, but try the neighbourhood of hint first.
+	// O(1) when key goes right before or right after hint.
+	template <class K>
+	tree_node* tree_hint_slot(tree_node *hint, const K& key, tree_node *&parent, bool &from_left) const {
+		if (hint == header) {
+			if (tree_size > 0 && key_less(key_of(header->right), key)) {
+				parent = header->right;
+				from_left = false;
+				return nullptr;
+			}
+			return tree_find_slot(key, parent, from_left);
+		}
+		if (key_less(key, key_of(hint))) {
+			if (hint == header->left) {
+				parent = hint;
+				from_left = true;
+				return nullptr;
+			}
+			tree_node *prev = hint;
+			tree_decreasement(prev);
+			if (key_less(key_of(prev), key)) {
+				// the predecessor has no right child, or hint has no left child.
+				if (!prev->right) {
+					parent = prev;
+					from_left = false;
+				} else {
+					parent = hint;
+					from_left = true;
+				}
+				return nullptr;
+			}
+			return tree_find_slot(key, parent, from_left);
+		}
+		if (key_less(key_of(hint), key)) {
+			tree_node *next = hint;
+			tree_increasment(next);
+			if (next == header || key_less(key, key_of(next))) {
+				if (!hint->right) {
+					parent = hint;
+					from_left = false;
+				} else {
+					parent = next;
+					from_left = true;
+				}
+				return nullptr;
+			}
+			return tree_find_slot(key, parent, from_left);
+		}
+		return hint;
+	}
+
+	// link a new node at the place found by tree_find_slot and rebalance.
+	void tree_link(tree_node *new_node, tree_node *parent, bool from_left) {
 		tree_size++;
-        auto new_node = new tree_node(key, T(), RED, parent);
+		new_node->set_parent(parent);
+		new_node->left = new_node->right = nullptr;
+		pull(new_node);
+		if (parent == header) {
+			new_node->set_color(BLACK);
+			header->set_parent(new_node);
+			header->left = header->right = new_node;
+			return;
+		}
+		new_node->set_color(RED);
         if (from_left) {
             parent->left = new_node;
             if (parent == header->left) {
@@ -252,17 +841,59 @@ private:
                 header->right = new_node;
             }
         }
+		pull_path(parent);
 
 		tree_insert_rebalance(new_node);
-        return make_pair(new_node, true);
 	}
 
-	tree_node* tree_access(const Key& key) const {
-		tree_node *p = header->parent;
+	// find key, or link a new node built from args.
+	template <class K, class... Args>
+	pair<tree_node*, bool> tree_get_or_emplace(tree_node *hint, const K& key, Args&&... args) {
+		tree_node *parent;
+		bool from_left;
+		tree_node *p = hint ? tree_hint_slot(hint, key, parent, from_left) : tree_find_slot(key, parent, from_left);
+		if (p) {
+			return pair<tree_node*, bool>(p, false);
+		}
+		tree_node *new_node = create_node(RED, parent, std::forward<Args>(args)...);
+		tree_link(new_node, parent, from_left);
+		return pair<tree_node*, bool>(new_node, true);
+	}
+
+	// the mapped value is value-initialized, and only on a miss.
+	pair<tree_node*, bool> tree_get_or_create(const Key& key) {
+		return tree_get_or_emplace(nullptr, key, std::piecewise_construct, std::forward_as_tuple(key), std::tuple<>());
+	}
+
+	// build the node first, then link it unless its key is there already.
+	template <class... Args>
+	pair<tree_node*, bool> tree_emplace(tree_node *hint, Args&&... args) {
+		tree_node *new_node = create_node(RED, nullptr, std::forward<Args>(args)...);
+		tree_node *parent;
+		bool from_left;
+		tree_node *p;
+		try {
+			p = hint ? tree_hint_slot(hint, key_of(new_node), parent, from_left)
+			         : tree_find_slot(key_of(new_node), parent, from_left);
+		} catch (...) {
+			destroy_node(new_node);
+			throw;
+		}
+		if (p) {
+			destroy_node(new_node);
+			return pair<tree_node*, bool>(p, false);
+		}
+		tree_link(new_node, parent, from_left);
+		return pair<tree_node*, bool>(new_node, true);
+	}
+
+	template <class K>
+	tree_node* tree_access(const K& key) const {
+		tree_node *p = header->parent();
 		while (p) {
-			if (Compare()(key, p->v->first)) 
+			if (key_less(key, key_of(p))) 
 				p = p->left;
-			else if (Compare()(p->v->first, key))
+			else if (key_less(key_of(p), key))
 				p = p->right;
 			else 
 				return p;
@@ -270,38 +901,192 @@ private:
 		return nullptr;
 	}
 
+	// first node with key not less than key, or header.
+	template <class K>
+	tree_node* tree_lower_bound(const K& key) const {
+		tree_node *p = header->parent(), *ret = header;
+		while (p) {
+			if (key_less(key_of(p), key)) {
+				p = p->right;
+			} else {
+				ret = p;
+				p = p->left;
+			}
+		}
+		return ret;
+	}
+
+	// first node with key greater than key, or header.
+	template <class K>
+	tree_node* tree_upper_bound(const K& key) const {
+		tree_node *p = header->parent(), *ret = header;
+		while (p) {
+			if (key_less(key, key_of(p))) {
+				ret = p;
+				p = p->left;
+			} else {
+				p = p->right;
+			}
+		}
+		return ret;
+	}
+
+	// lookups of a batch run in groups of batch_group, all of a group one
+	// level at a time, so that their cache misses overlap instead of
+	// coming one after another: the next node of every lookup is
+	// prefetched, and the others are compared meanwhile.
+	static constexpr size_t batch_group = 16;
+
+	// call found(i, node of keys[i] or header) for every i in [0, n).
+	template <class F>
+	void tree_find_batch(const Key *keys, size_t n, F found) const {
+		tree_node *cur[batch_group], *ret[batch_group];
+		for (size_t base = 0; base < n; base += batch_group) {
+			size_t m = std::min(batch_group, n - base);
+			const Key *k = keys + base;
+			for (size_t g = 0; g < m; ++g) {
+				cur[g] = header->parent();
+				ret[g] = header;
+			}
+			// a lower bound descent, with one comparison per level.
+			for (bool more = true; more; ) {
+				more = false;
+				for (size_t g = 0; g < m; ++g) {
+					tree_node *p = cur[g];
+					if (!p) continue;
+					if (key_less(key_of(p), k[g])) {
+						p = p->right;
+					} else {
+						ret[g] = p;
+						p = p->left;
+					}
+					if (p) {
+						__builtin_prefetch(p);
+						__builtin_prefetch(&key_of(p));
+						more = true;
+					}
+					cur[g] = p;
+				}
+			}
+			for (size_t g = 0; g < m; ++g) {
+				tree_node *p = ret[g];
+				found(base + g, p != header && !key_less(k[g], key_of(p)) ? p : header);
+			}
+		}
+	}
+
+	tree_node* tree_select(size_t k) const {
+		static_assert(std::is_same<Augment, order_statistics>::value, "select needs order_statistics");
+		if (k >= tree_size) return header;
+		tree_node *p = header->parent();
+		while (true) {
+			size_t l = subtree_size(p->left);
+			if (k < l) {
+				p = p->left;
+			} else if (k == l) {
+				return p;
+			} else {
+				k -= l + 1;
+				p = p->right;
+			}
+		}
+	}
+
+	template <class K>
+	size_t tree_rank(const K& key) const {
+		static_assert(std::is_same<Augment, order_statistics>::value, "rank needs order_statistics");
+		tree_node *p = header->parent();
+		size_t r = 0;
+		while (p) {
+			if (key_less(key_of(p), key)) {
+				r += subtree_size(p->left) + 1;
+				p = p->right;
+			} else {
+				p = p->left;
+			}
+		}
+		return r;
+	}
+
+	size_t tree_index(tree_node *p) const {
+		static_assert(std::is_same<Augment, order_statistics>::value, "index_of needs order_statistics");
+		if (p == header) return tree_size;
+		size_t r = subtree_size(p->left);
+		for (; p->parent() != header; p = p->parent()) {
+			if (p == p->parent()->right) r += subtree_size(p->parent()->left) + 1;
+		}
+		return r;
+	}
+
+	// the aggregate of the keys in [lo, hi): below the first node in range,
+	// whole subtrees on the inner side of both boundary paths are taken
+	// as they are.
+	template <class K>
+	aggregate_type tree_aggregate(const K& lo, const K& hi) const {
+		using A = Augment;
+		tree_node *p = header->parent();
+		while (p) {
+			if (key_less(key_of(p), lo))
+				p = p->right;
+			else if (!key_less(key_of(p), hi))
+				p = p->left;
+			else
+				break;
+		}
+		if (!p) return A::identity();
+		aggregate_type l = A::identity(), r = A::identity();
+		for (tree_node *q = p->left; q; ) {
+			if (key_less(key_of(q), lo)) {
+				q = q->right;
+			} else {
+				l = A::combine(A::combine(A::lift(value_of(q)), subtree_agg(q->right)), l);
+				q = q->left;
+			}
+		}
+		for (tree_node *q = p->right; q; ) {
+			if (key_less(key_of(q), hi)) {
+				r = A::combine(r, A::combine(subtree_agg(q->left), A::lift(value_of(q))));
+				q = q->right;
+			} else {
+				q = q->left;
+			}
+		}
+		return A::combine(l, A::combine(A::lift(value_of(p)), r));
+	}
+
 	void remove_tree_all(tree_node *root) {
 		if (root == nullptr) return;
 		remove_tree_all(root->left);
 		remove_tree_all(root->right);
-		delete root;
+		destroy_node(root);
 	}
 
 	void Transplant(tree_node *p, tree_node *q) {
-		if (header->parent == p)      
-			header->parent = q;
-		else if (p->parent->left == p)
-			p->parent->left = q;
-		else p->parent->right = q;
+		if (header->parent() == p)      
+			header->set_parent(q);
+		else if (p->parent()->left == p)
+			p->parent()->left = q;
+		else p->parent()->right = q;
 			
 		if (q) 
-			q->parent = p->parent;
+			q->set_parent(p->parent());
 	}
 
 	void header_replace(tree_node *p) {
 		if (p == header->left) {
 			if (p->right) header->left = retrieve_succ(p);
-			else header->left = p->parent;
+			else header->left = p->parent();
 		}
 		if (p == header->right) {
 			if (p->left) header->right = retrieve_pred(p);
-			else header->right = p->parent;
+			else header->right = p->parent();
 		}
 	}
 
-	void tree_remove(tree_node* p) {
+	// take p out of the tree, keeping the node.
+	void tree_unlink(tree_node* p) {
 		tree_node *x = nullptr;
-		color_t orig_color = p->color;
+		color_t orig_color = p->color();
 		tree_node *parent;
 		bool from_left = true;
 		--tree_size;
@@ -311,40 +1096,47 @@ private:
 			from_left = false;
 			header_replace(p);
 			Transplant(p, x);
-			parent = p->parent;
+			parent = p->parent();
 		}
 		else if (p->right == nullptr) {
 			x = p->left;
 			header_replace(p);
 			Transplant(p, x);
-			parent = p->parent;
+			parent = p->parent();
 		}
 		else {
 			tree_node *y = retrieve_succ(p);
-			orig_color = y->color;
+			orig_color = y->color();
 			x = y->right;
-			if (y->parent != p) {
+			if (y->parent() != p) {
 				Transplant(y, x);
 				y->right = p->right;
-				y->right->parent = y;
-				parent = y->parent;
+				y->right->set_parent(y);
+				parent = y->parent();
 			} else {
 				parent = y;
 			}
 			Transplant(p, y);
 			y->left = p->left;
-			y->left->parent = y;
-			y->color = p->color;
+			y->left->set_parent(y);
+			y->set_color(p->color());
 		}
 
-		delete p;
+		// everything below parent kept its shape.
+		pull_path(parent);
 
 		if (orig_color == BLACK) {
 			tree_delete_rebalance(x, parent);
 		}
 	}
+
+	void tree_remove(tree_node* p) {
+		tree_unlink(p);
+		destroy_node(p);
+	}
 	
 
+	// climb by pointer identity: no key is copied or compared.
 	bool tree_increasment(tree_node *&ptr) const {
 		if (ptr == header) {
 			return false;
@@ -352,11 +1144,12 @@ private:
 			if (ptr->right) {
 				ptr = retrieve_succ(ptr);
 			} else {
-				Key key_ptr = ptr->v->first;
-				ptr = ptr->parent;
-				while (ptr != header && Compare()(ptr->v->first, key_ptr)) {
-					ptr = ptr->parent;
+				tree_node *p = ptr->parent();
+				while (p != header && ptr == p->right) {
+					ptr = p;
+					p = p->parent();
 				}
+				ptr = p;
 			}
 			return true;
 		}
@@ -373,25 +1166,530 @@ private:
 			if (ptr->left) {
 				ptr = retrieve_pred(ptr);
 			} else {
-				Key key_ptr = ptr->v->first;
-				ptr = ptr->parent;
-				while (Compare()(key_ptr, ptr->v->first)) {
-					ptr = ptr->parent;
+				tree_node *p = ptr->parent();
+				while (ptr == p->left) {
+					ptr = p;
+					p = p->parent();
 				}
+				ptr = p;
 			}
 			return true;
 		}
 	}
 
+	// build a balanced tree from the next n values of it, in order.
+	// nodes are created in key order, so the pool lays them out
+	// contiguously; nodes on depth red_depth (the last, partial level)
+	// are red and all the others black. if a value throws, the nodes
+	// built so far are freed.
+	template <class It, class Get>
+	tree_node* tree_build(It &it, size_t n, int depth, int red_depth, Get get) {
+		if (n == 0) return nullptr;
+		size_t n_left = (n - 1) / 2;
+		tree_node *left = tree_build(it, n_left, depth + 1, red_depth, get);
+		tree_node *p;
+		try {
+			p = create_node(depth == red_depth ? RED : BLACK, nullptr, get(*it));
+		} catch (...) {
+			remove_tree_all(left);
+			throw;
+		}
+		if (left) left->set_parent(p);
+		p->left = left;
+		try {
+			++it;
+			p->right = tree_build(it, n - 1 - n_left, depth + 1, red_depth, get);
+			pull(p);
+		} catch (...) {
+			remove_tree_all(p);
+			throw;
+		}
+		if (p->right) p->right->set_parent(p);
+		return p;
+	}
+
+	// replace the (empty) tree with the n values of [it, it + n). the
+	// header is linked only once the tree is whole.
+	template <class It, class Get>
+	void tree_build_all(It it, size_t n, Get get) {
+		int red_depth = 0;
+		while ((size_t(2) << red_depth) <= n) ++red_depth;
+		if (red_depth == 0) red_depth = -1;
+		pool.reserve(n);
+		tree_node *root = tree_build(it, n, 0, red_depth, get);
+		header->set_parent(root);
+		tree_size = n;
+		if (!root) return;
+		root->set_parent(header);
+		tree_node *p = root;
+		while (p->left) p = p->left;
+		header->left = p;
+		p = root;
+		while (p->right) p = p->right;
+		header->right = p;
+	}
+
+	struct identity {
+		template <class V>
+		const V & operator()(const V &v) const { return v; }
+	};
+
+	struct dereference {
+		template <class V>
+		const V & operator()(const V *v) const { return *v; }
+	};
+
+	struct move_value {
+		value_type && operator()(value_type &v) const { return std::move(v); }
+	};
+
+	// save writes "SJTUMAP" and a version byte, then a format byte, for
+	// the packed format sizeof(Key) and sizeof(T), then the element count
+	// and the elements in key order. packed entries are the bytes of the
+	// key and the value back to back.
+	static constexpr bool packed_io = std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<T>::value;
+	static constexpr size_t packed_stride = sizeof(Key) + sizeof(T);
+	static constexpr const char *save_magic = "SJTUMAP\x01";
+
+	// the packed entries in memory, read in place.
+	struct packed_cursor {
+		const char *p;
+		value_type operator*() const {
+			return value_type(serializer<Key>::unpack(p), serializer<T>::unpack(p + sizeof(Key)));
+		}
+		packed_cursor & operator++() {
+			p += packed_stride;
+			return *this;
+		}
+	};
+
+	void save_header(std::ostream &os) const {
+		os.write(save_magic, 8);
+		os.put(packed_io ? 1 : 0);
+		if (packed_io) {
+			write_varint(os, sizeof(Key));
+			write_varint(os, sizeof(T));
+		}
+		write_varint(os, tree_size);
+	}
+
+	// check that the header suits this map, and return the count.
+	static size_t load_header(std::istream &is) {
+		char magic[8];
+		if (!is.read(magic, 8) || std::memcmp(magic, save_magic, 8)) throw runtime_error();
+		if (is.get() != (packed_io ? 1 : 0)) throw runtime_error();
+		if (packed_io && (read_varint(is) != sizeof(Key) || read_varint(is) != sizeof(T))) throw runtime_error();
+		unsigned long long n = read_varint(is);
+		if (n > (size_t)-1) throw runtime_error();
+		return (size_t)n;
+	}
+
+	void save_entries(std::ostream &os, std::true_type) const {
+		std::vector<char, char_allocator> buf(std::max(packed_stride, size_t(1) << 16), char(), char_allocator(alloc));
+		size_t used = 0;
+		for (tree_node *p = header->left; p != header; tree_increasment(p)) {
+			if (used + packed_stride > buf.size()) {
+				os.write(buf.data(), used);
+				used = 0;
+			}
+			serializer<Key>::pack(&buf[used], key_of(p));
+			serializer<T>::pack(&buf[used + sizeof(Key)], value_of(p).second);
+			used += packed_stride;
+		}
+		os.write(buf.data(), used);
+	}
+
+	void save_entries(std::ostream &os, std::false_type) const {
+		for (tree_node *p = header->left; p != header; tree_increasment(p)) {
+			serializer<Key>::write(os, key_of(p));
+			serializer<T>::write(os, value_of(p).second);
+		}
+	}
+
+	// replace the elements with the n packed entries at p.
+	void load_packed(const char *p, size_t n) {
+		for (size_t i = 1; i < n; ++i) {
+			if (!key_less(serializer<Key>::unpack(p + (i - 1) * packed_stride), serializer<Key>::unpack(p + i * packed_stride)))
+				throw runtime_error();
+		}
+		clear();
+		tree_build_all(packed_cursor{p}, n, identity());
+	}
+
+	// read in pieces, so that a corrupt count fails on the read instead
+	// of allocating it.
+	void load_entries(std::istream &is, size_t n, std::true_type) {
+		if (n > (size_t)-1 / packed_stride) throw runtime_error();
+		size_t bytes = n * packed_stride;
+		std::vector<char, char_allocator> buf{char_allocator(alloc)};
+		while (buf.size() < bytes) {
+			size_t have = buf.size(), step = std::min(bytes - have, size_t(1) << 24);
+			buf.resize(have + step);
+			if (!is.read(buf.data() + have, step)) throw runtime_error();
+		}
+		load_packed(buf.data(), n);
+	}
+
+	void load_entries(std::istream &is, size_t n, std::false_type) {
+		std::vector<value_type, value_allocator> values{value_allocator(alloc)};
+		values.reserve(std::min(n, size_t(1) << 16));
+		for (size_t i = 0; i < n; ++i) {
+			Key key = serializer<Key>::read(is);
+			T value = serializer<T>::read(is);
+			if (i > 0 && !key_less(values.back().first, key)) throw runtime_error();
+			values.emplace_back(std::move(key), std::move(value));
+		}
+		clear();
+		tree_build_all(values.begin(), n, move_value());
+	}
+
+	void load_file(const char *, std::ifstream &is, std::false_type) { load(is); }
+
+	void load_file(const char *path, std::ifstream &is, std::true_type) {
+#ifdef SJTU_MAP_MMAP
+		size_t n = load_header(is);
+		std::streamoff offset = is.tellg();
+		is.close();
+		mapped_file f(path);
+		if (offset < 0 || (unsigned long long)f.size() < (unsigned long long)offset ||
+			n > (f.size() - offset) / packed_stride) throw runtime_error();
+		load_packed(f.data() + offset, n);
+#else
+		(void)path;
+		load(is);
+#endif
+	}
+
+	// sort the values of a range by key, keeping the first of equal keys.
+	template <class InputIt>
+	void tree_build_unsorted(InputIt first, InputIt last) {
+		std::vector<value_type, value_allocator> values(first, last, value_allocator(alloc));
+		std::vector<const value_type*, pointer_allocator> order{pointer_allocator(alloc)};
+		order.reserve(values.size());
+		for (const value_type &v : values) order.push_back(&v);
+		const Compare &c = comp();
+		std::stable_sort(order.begin(), order.end(), [&c](const value_type *a, const value_type *b) {
+			return c(a->first, b->first);
+		});
+		order.erase(std::unique(order.begin(), order.end(), [&c](const value_type *a, const value_type *b) {
+			return !c(a->first, b->first) && !c(b->first, a->first);
+		}), order.end());
+		tree_build_all(order.begin(), order.size(), dereference());
+	}
+
+	// a tree cut loose from the header, with its black height: the black
+	// nodes on a path from root to a leaf. the root may be red.
+	struct subtree {
+		tree_node *root;
+		int bh;
+	};
+
+	static subtree tree_detach_child(tree_node *c, int bh) {
+		if (c) c->set_parent(nullptr);
+		return subtree{c, bh};
+	}
+
+	static void blacken(subtree &t) {
+		if (is_red(t.root)) {
+			t.root->set_color(BLACK);
+			++t.bh;
+		}
+	}
+
+	subtree tree_detach() {
+		subtree t{header->parent(), 0};
+		for (tree_node *p = t.root; p; p = p->left) t.bh += is_black(p);
+		if (t.root) t.root->set_parent(nullptr);
+		header->set_parent(nullptr);
+		header->left = header->right = header;
+		tree_size = 0;
+		return t;
+	}
+
+	void tree_attach(subtree t, size_t n) {
+		header->set_parent(t.root);
+		tree_size = n;
+		if (!t.root) {
+			header->left = header->right = header;
+			return;
+		}
+		t.root->set_parent(header);
+		t.root->set_color(BLACK);
+		tree_node *p = t.root;
+		while (p->left) p = p->left;
+		header->left = p;
+		p = t.root;
+		while (p->right) p = p->right;
+		header->right = p;
+	}
+
+	// the tree of l, x and r, where x goes between the keys of l and r.
+	// x is linked where the black heights meet on the spine of the
+	// taller tree, then fixed up like an insert: O(|l.bh - r.bh| + 1).
+	subtree tree_join(subtree l, tree_node *x, subtree r) {
+		blacken(l);
+		blacken(r);
+		if (l.bh == r.bh) {
+			x->left = l.root;
+			x->right = r.root;
+			if (l.root) l.root->set_parent(x);
+			if (r.root) r.root->set_parent(x);
+			x->set_parent(nullptr);
+			x->set_color(BLACK);
+			pull(x);
+			return subtree{x, l.bh + 1};
+		}
+		// a header for the fixup.
+		tree_node top;
+		tree_node *p = &top, *y;
+		int h;
+		if (l.bh > r.bh) {
+			top.set_parent(l.root);
+			l.root->set_parent(&top);
+			for (y = l.root, h = l.bh; !(is_black(y) && h == r.bh); y = y->right) {
+				if (is_black(y)) --h;
+				p = y;
+			}
+			x->left = y;
+			x->right = r.root;
+			p->right = x;
+		} else {
+			top.set_parent(r.root);
+			r.root->set_parent(&top);
+			for (y = r.root, h = r.bh; !(is_black(y) && h == l.bh); y = y->left) {
+				if (is_black(y)) --h;
+				p = y;
+			}
+			x->left = l.root;
+			x->right = y;
+			p->left = x;
+		}
+		if (x->left) x->left->set_parent(x);
+		if (x->right) x->right->set_parent(x);
+		x->set_parent(p);
+		x->set_color(RED);
+		pull(x);
+		pull_path(p, &top, Augment());
+		int bh = (l.bh > r.bh ? l.bh : r.bh) + tree_insert_rebalance(x, &top);
+		tree_node *root = top.parent();
+		root->set_parent(nullptr);
+		return subtree{root, bh};
+	}
+
+	// take the least node out of t.
+	subtree tree_split_first(subtree t, tree_node *&first) {
+		tree_node *x = t.root;
+		int bh = t.bh - is_black(x);
+		subtree a = tree_detach_child(x->left, bh), b = tree_detach_child(x->right, bh);
+		if (!a.root) {
+			first = x;
+			return b;
+		}
+		return tree_join(tree_split_first(a, first), x, b);
+	}
+
+	// the tree of l and r, the keys of l being less.
+	subtree tree_join2(subtree l, subtree r) {
+		if (!l.root) return r;
+		if (!r.root) return l;
+		tree_node *first;
+		r = tree_split_first(r, first);
+		return tree_join(l, first, r);
+	}
+
+	// cut t into the keys less than key, the node of key (or nullptr) and
+	// the keys greater. O(log n): one join per level.
+	template <class K>
+	void tree_split(subtree t, const K &key, subtree &l, tree_node *&mid, subtree &r) {
+		if (!t.root) {
+			l = r = subtree{nullptr, 0};
+			mid = nullptr;
+			return;
+		}
+		tree_node *x = t.root;
+		int bh = t.bh - is_black(x);
+		subtree a = tree_detach_child(x->left, bh), b = tree_detach_child(x->right, bh);
+		if (key_less(key, key_of(x))) {
+			tree_split(a, key, l, mid, r);
+			r = tree_join(r, x, b);
+		} else if (key_less(key_of(x), key)) {
+			tree_split(b, key, l, mid, r);
+			l = tree_join(a, x, l);
+		} else {
+			l = a;
+			mid = x;
+			r = b;
+		}
+	}
+
+	// subtrees a set operation cut off, destroyed once it is over.
+	// linked through the parent of their roots.
+	struct drop_list {
+		tree_node *head = nullptr, *tail = nullptr;
+		void push(tree_node *p) {
+			p->set_parent(nullptr);
+			if (tail) tail->set_parent(p);
+			else head = p;
+			tail = p;
+		}
+		void append(const drop_list &other) {
+			if (!other.head) return;
+			if (tail) tail->set_parent(other.head);
+			else head = other.head;
+			tail = other.tail;
+		}
+	};
+
+	// found counts the keys met in both trees.
+	struct set_result {
+		subtree t;
+		drop_list drop;
+		size_t found;
+	};
+
+	void tree_drop(const drop_list &drop) {
+		for (tree_node *p = drop.head; p; ) {
+			tree_node *next = p->parent();
+			remove_tree_all(p);
+			p = next;
+		}
+	}
+
+	// subtrees under this black height are not worth a thread.
+	static constexpr int parallel_min_bh = 8;
+
+	// levels of the recursion that fork, enough for every core.
+	static int parallel_depth() {
+		unsigned n = std::thread::hardware_concurrency();
+		if (n <= 1) return 0;
+		int d = 1;
+		while ((1u << d) < n) ++d;
+		return d + 1;
+	}
+
+	// run f and g, f on another thread when par is set.
+	template <class F, class G>
+	static void fork(bool par, F f, G g) {
+		if (par) {
+			std::future<void> done;
+			try {
+				done = std::async(std::launch::async, f);
+			} catch (...) {
+				par = false;
+			}
+			if (par) {
+				g();
+				done.get();
+				return;
+			}
+		}
+		f();
+		g();
+	}
+
+	// a and b are consumed; on equal keys the node of a stays.
+	set_result tree_union(subtree a, subtree b, int par) {
+		if (!b.root) return set_result{a, drop_list(), 0};
+		if (!a.root) return set_result{b, drop_list(), 0};
+		tree_node *k = b.root;
+		int bh = b.bh - is_black(k);
+		subtree bl = tree_detach_child(k->left, bh), br = tree_detach_child(k->right, bh);
+		subtree al, ar;
+		tree_node *m;
+		tree_split(a, key_of(k), al, m, ar);
+		set_result L, R;
+		fork(par > 0 && a.bh + b.bh >= parallel_min_bh,
+			[&] { L = tree_union(al, bl, par - 1); },
+			[&] { R = tree_union(ar, br, par - 1); });
+		set_result res{subtree(), L.drop, L.found + R.found};
+		res.drop.append(R.drop);
+		if (m) {
+			k->left = k->right = nullptr;
+			res.drop.push(k);
+			++res.found;
+			res.t = tree_join(L.t, m, R.t);
+		} else {
+			res.t = tree_join(L.t, k, R.t);
+		}
+		return res;
+	}
+
+	// a is consumed, b only read.
+	set_result tree_intersect(subtree a, tree_node *b, int par) {
+		if (!a.root) return set_result{a, drop_list(), 0};
+		if (!b) {
+			set_result res{subtree{nullptr, 0}, drop_list(), 0};
+			res.drop.push(a.root);
+			return res;
+		}
+		subtree al, ar;
+		tree_node *m;
+		tree_split(a, key_of(b), al, m, ar);
+		set_result L, R;
+		fork(par > 0 && a.bh >= parallel_min_bh,
+			[&] { L = tree_intersect(al, b->left, par - 1); },
+			[&] { R = tree_intersect(ar, b->right, par - 1); });
+		set_result res{subtree(), L.drop, L.found + R.found};
+		res.drop.append(R.drop);
+		if (m) {
+			++res.found;
+			res.t = tree_join(L.t, m, R.t);
+		} else {
+			res.t = tree_join2(L.t, R.t);
+		}
+		return res;
+	}
+
+	// a is consumed, b only read.
+	set_result tree_difference(subtree a, tree_node *b, int par) {
+		if (!a.root || !b) return set_result{a, drop_list(), 0};
+		subtree al, ar;
+		tree_node *m;
+		tree_split(a, key_of(b), al, m, ar);
+		set_result L, R;
+		fork(par > 0 && a.bh >= parallel_min_bh,
+			[&] { L = tree_difference(al, b->left, par - 1); },
+			[&] { R = tree_difference(ar, b->right, par - 1); });
+		set_result res{subtree(), L.drop, L.found + R.found};
+		res.drop.append(R.drop);
+		if (m) {
+			m->left = m->right = nullptr;
+			res.drop.push(m);
+			++res.found;
+		}
+		res.t = tree_join2(L.t, R.t);
+		return res;
+	}
+
+	// set the sizes of this and right, which hold total elements.
+	void split_sizes(map &right, size_t total, order_statistics) {
+		tree_size = subtree_size(header->parent());
+		right.tree_size = total - tree_size;
+	}
+	// count the smaller side by walking both at once, O(min(k, n - k)).
+	template <class A>
+	void split_sizes(map &right, size_t total, A) {
+		tree_node *p = header->left, *q = right.header->left;
+		size_t n = 0;
+		while (p != header && q != right.header) {
+			tree_increasment(p);
+			right.tree_increasment(q);
+			++n;
+		}
+		tree_size = p == header ? n : total - n;
+		right.tree_size = total - tree_size;
+	}
+
 	tree_node* tree_copy(tree_node* this_from, tree_node *other_p, const map &other) {
 		if (other_p == nullptr) {
 			return nullptr;
 		}
 		tree_node* this_p;
 		
-		this_p = new tree_node(other_p->v->first, other_p->v->second, other_p->color, this_from);
+		this_p = create_node(other_p->color(), this_from, value_of(other_p));
 		this_p->left = tree_copy(this_p, other_p->left, other);
 		this_p->right = tree_copy(this_p, other_p->right, other);
+		pull(this_p);
 
 		if (other_p == other.header->right)
 			header->right = this_p;
@@ -402,9 +1700,10 @@ private:
 	}
 
 	void new_header() {
-		header = new tree_node();
+		header_allocator ha(alloc);
+		header = new (header_traits::allocate(ha, 1)) tree_node();
 		header->left = header->right = header;
-		header->parent = nullptr;
+		header->set_parent(nullptr);
 	}
 public:
 	class const_iterator;
@@ -418,6 +1717,7 @@ public:
 		iterator(): mp_belong(nullptr), ptr(nullptr) {} 
 		iterator(const iterator &other): mp_belong(other.mp_belong), ptr(other.ptr) {}
 		iterator(const const_iterator &other): mp_belong(other.mp_belong), ptr(other.ptr) {}
+		iterator & operator=(const iterator &other) = default;
 
 		iterator operator++(int) {
 			auto tmp = ptr;
@@ -455,10 +1755,10 @@ public:
 			       && ptr == rhs.ptr;
 		}
 
-		value_type & operator*() const { return *(ptr->v); }
+		element_ref operator*() const { return value_of(ptr); }
 		bool operator!=(const iterator &rhs) const { return !(*this == rhs); }
 		bool operator!=(const const_iterator &rhs) const { return !(*this == rhs); }
-		value_type* operator->() const noexcept { return ptr->v; }
+		typename std::remove_reference<element_ref>::type * operator->() const noexcept { return &value_of(ptr); }
 	};
 	class const_iterator {
 		friend class map;
@@ -469,6 +1769,7 @@ public:
 		const_iterator() : mp_belong(nullptr), ptr(nullptr) {} 
 		const_iterator(const const_iterator &other): mp_belong(other.mp_belong), ptr(other.ptr) {}
 		const_iterator(const iterator &other) : mp_belong(other.mp_belong), ptr(other.ptr) {}
+		const_iterator & operator=(const const_iterator &other) = default;
 
 		const_iterator operator++(int) {
 			auto tmp = ptr;
@@ -506,74 +1807,213 @@ public:
 				&& ptr == rhs.ptr;
 		}
 
-		value_type & operator*() const { return *(ptr->v); }
+		element_ref operator*() const { return value_of(ptr); }
 		bool operator!=(const iterator &rhs) const { return !(*this == rhs); }
 		bool operator!=(const const_iterator &rhs) const { return !(*this == rhs); }
-		value_type* operator->() const noexcept { return ptr->v; }
+		typename std::remove_reference<element_ref>::type * operator->() const noexcept { return &value_of(ptr); }
+	};
+
+	// [begin(), end()) of a key range, usable in a range-based for.
+	template <class It>
+	struct range_view {
+		It first, last;
+		It begin() const { return first; }
+		It end() const { return last; }
+		bool empty() const { return first == last; }
 	};
 
-	map() : tree_size(0) { new_header(); }
+	// an element taken out of a map with its node, to be inserted into
+	// another map without copying the value.
+	class node_type {
+		friend class map;
+		tree_node *node;
+		Allocator alloc;
+		node_type(tree_node *node, const Allocator &alloc): node(node), alloc(alloc) {}
+		void reset() {
+			if (node) {
+				value_node *p = static_cast<value_node*>(node);
+				alloc_traits::destroy(alloc, p->v());
+				p->~value_node();
+				pool_type::release(p);
+				node = nullptr;
+			}
+		}
+	public:
+		node_type(): node(nullptr), alloc() {}
+		node_type(node_type &&other): node(other.node), alloc(other.alloc) {
+			other.node = nullptr;
+		}
+		node_type & operator=(node_type &&other) {
+			if (this != &other) {
+				reset();
+				node = other.node;
+				alloc = other.alloc;
+				other.node = nullptr;
+			}
+			return *this;
+		}
+		~node_type() { reset(); }
+
+		bool empty() const { return node == nullptr; }
+		explicit operator bool() const { return node != nullptr; }
+		allocator_type get_allocator() const { return alloc; }
+		const Key & key() const { return key_of(node); }
+		T & mapped() const { return value_of(node).second; }
+		value_type & value() const { return value_of(node); }
+	};
+
+	struct insert_return_type {
+		iterator position;
+		bool inserted;
+		node_type node;
+	};
+
+private:
+	node_type tree_extract(tree_node *p) {
+		tree_unlink(p);
+		return node_type(p, alloc);
+	}
+
+	tree_node* hint_node(const const_iterator &hint) const {
+		return hint.mp_belong == this && hint.ptr ? hint.ptr : header;
+	}
+
+public:
+	map() : map(Allocator()) {}
+
+	explicit map(const Allocator &a) : map(Compare(), a) {}
+
+	explicit map(const Compare &c, const Allocator &a = Allocator()) :
+		compare_holder<Compare>(c), tree_size(0), alloc(a), pool(alloc) { new_header(); }
+
+	// from any range: sorted first, O(n log n).
+	template <class InputIt>
+	map(InputIt first, InputIt last, const Compare &c = Compare(), const Allocator &a = Allocator()) :
+		map(c, a) {
+		tree_build_unsorted(first, last);
+	}
+
+	// from a range sorted by key without duplicates: O(n).
+	template <class ForwardIt>
+	map(sorted_unique_t, ForwardIt first, ForwardIt last, const Compare &c = Compare(), const Allocator &a = Allocator()) :
+		map(c, a) {
+		tree_build_all(first, (size_t)std::distance(first, last), identity());
+	}
 
-	map(const map &other) {
+	// takes the nodes of other, which is left empty.
+	map(map &&other) : compare_holder<Compare>(other.comp()), tree_size(0), alloc(other.alloc), pool(alloc) {
+		new_header();
+		pool.swap(other.pool);
+		size_t n = other.tree_size;
+		tree_attach(other.tree_detach(), n);
+	}
+
+	map(const map &other) : compare_holder<Compare>(other.comp()),
+		alloc(alloc_traits::select_on_container_copy_construction(other.alloc)), pool(alloc) {
 		if (other.empty()) {
 			new_header();
 			tree_size = 0;
 		} else {
             new_header();
-			header->parent = tree_copy(header, other.header->parent, other);
+			header->set_parent(tree_copy(header, other.header->parent(), other));
 			tree_size = other.tree_size;
 		}
 	}
 
+	// nodes on the longest path down from root.
 	int G(tree_node *root) const {
 		if (!root) return 0;
 		int aa = G(root->left);
 		int bb = G(root->right);
-		return aa > bb ? aa : bb + 1;
+		return (aa > bb ? aa : bb) + 1;
 	}
 
 	int get_depth() const {
 		// debug
-		return G(header->parent);
+		return G(header->parent());
 	}
 
 	map & operator=(const map &other) {
 		if (this != &other) {
+			comp() = other.comp();
 			if (header)
-				remove_tree_all(header->parent);
+				clear();
 			else 
 				new_header();
-            header->parent = tree_copy(header, other.header->parent, other);
+            header->set_parent(tree_copy(header, other.header->parent(), other));
             tree_size = other.tree_size;
 		}
 		return *this;
 	}
 
+	// takes the nodes of other, which is left empty, like the move
+	// constructor: O(1) but for freeing the old elements.
+	map & operator=(map &&other) {
+		if (this != &other) {
+			clear();
+			comp() = other.comp();
+			pool.swap(other.pool);
+			size_t n = other.tree_size;
+			tree_attach(other.tree_detach(), n);
+		}
+		return *this;
+	}
+
 	~map() {
-		remove_tree_all(header->parent);
-		if (header) delete header;
+		remove_tree_all(header->parent());
+		if (header) {
+			header_allocator ha(alloc);
+			header->~tree_node();
+			header_traits::deallocate(ha, header, 1);
+		}
 	}
 
-	T & at(const Key &key) {
+	mapped_ref at(const Key &key) {
 		tree_node* res = tree_access(key);
-		if (res) return res->v->second;
+		if (res) return value_of(res).second;
 		throw index_out_of_bound();
 	}
 	const T & at(const Key &key) const {
 		tree_node* res = tree_access(key);
-		if (res) return res->v->second;
+		if (res) return value_of(res).second;
+		throw index_out_of_bound();
+	}
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	mapped_ref at(const K &key) {
+		tree_node* res = tree_access(key);
+		if (res) return value_of(res).second;
+		throw index_out_of_bound();
+	}
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	const T & at(const K &key) const {
+		tree_node* res = tree_access(key);
+		if (res) return value_of(res).second;
 		throw index_out_of_bound();
 	}
 
-	T & operator[](const Key &key) {
+	mapped_ref operator[](const Key &key) {
 		auto result = tree_get_or_create(key);
-		return result.first->v->second;
+		return value_of(result.first).second;
 	}
 
+	// with SJTU_UNCHECKED defined, a missing key is undefined behaviour
+	// instead of a throw.
 	const T & operator[](const Key &key) const {
 		tree_node* res = tree_access(key);
-		if (res) return res->v->second;
-		throw index_out_of_bound();
+#ifndef SJTU_UNCHECKED
+		if (!res) throw index_out_of_bound();
+#endif
+		return value_of(res).second;
+	}
+
+	// like at(), but return nullptr instead of throwing.
+	typename std::remove_reference<mapped_ref>::type * try_at(const Key &key) {
+		tree_node* res = tree_access(key);
+		return res ? &value_of(res).second : nullptr;
+	}
+	const T * try_at(const Key &key) const {
+		tree_node* res = tree_access(key);
+		return res ? &value_of(res).second : nullptr;
 	}
 
 	iterator begin() { return iterator(this, header->left); }
@@ -581,30 +2021,204 @@ public:
 	iterator end() { return iterator(this, header); }
 	const_iterator cend() const { return const_iterator(this, header); }
 
+	allocator_type get_allocator() const { return alloc; }
+	key_compare key_comp() const { return comp(); }
+
 	bool empty() const { return tree_size == 0; }
 	size_t size() const { return tree_size; }
 	size_t count(const Key &key) const { return tree_access(key) ? 1 : 0; }
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	size_t count(const K &key) const { return tree_access(key) ? 1 : 0; }
+
+	// make room for n elements, so that inserting up to n allocates nothing.
+	// erased nodes are kept for later inserts until the map is destroyed.
+	void reserve(size_t n) {
+		if (n > tree_size) pool.reserve(n - tree_size);
+	}
 
 	void clear() {
-		remove_tree_all(header->parent);
+		remove_tree_all(header->parent());
 		header->left = header->right = header;
-		header->parent = nullptr;
+		header->set_parent(nullptr);
 		tree_size = 0;
 	}
 
+	// replace the content with a range sorted by key without duplicates,
+	// in O(n).
+	template <class ForwardIt>
+	void assign_sorted(ForwardIt first, ForwardIt last) {
+		clear();
+		tree_build_all(first, (size_t)std::distance(first, last), identity());
+	}
+
 	pair<iterator, bool> insert(const value_type &value) {
-		pair<tree_node*, bool> result = tree_get_or_create(value.first);
-		if (result.second) 
-			result.first->v->second = value.second;
+		pair<tree_node*, bool> result = tree_get_or_emplace(nullptr, value.first, value);
 		return make_pair(iterator(this, result.first), result.second);
 	}
 
-	void erase(iterator pos) {
+	pair<iterator, bool> insert(value_type &&value) {
+		pair<tree_node*, bool> result = tree_get_or_emplace(nullptr, value.first, std::move(value));
+		return make_pair(iterator(this, result.first), result.second);
+	}
+
+	// hinted insert: amortized O(1) when value goes right before or after hint.
+	iterator insert(const_iterator hint, const value_type &value) {
+		return iterator(this, tree_get_or_emplace(hint_node(hint), value.first, value).first);
+	}
+
+	iterator insert(const_iterator hint, value_type &&value) {
+		return iterator(this, tree_get_or_emplace(hint_node(hint), value.first, std::move(value)).first);
+	}
+
+	// the value is built before the lookup, as the key comes from it.
+	template <class... Args>
+	pair<iterator, bool> emplace(Args&&... args) {
+		pair<tree_node*, bool> result = tree_emplace(nullptr, std::forward<Args>(args)...);
+		return make_pair(iterator(this, result.first), result.second);
+	}
+
+	template <class... Args>
+	iterator emplace_hint(const_iterator hint, Args&&... args) {
+		return iterator(this, tree_emplace(hint_node(hint), std::forward<Args>(args)...).first);
+	}
+
+	// nothing is constructed when key is already there.
+	template <class... Args>
+	pair<iterator, bool> try_emplace(const Key &key, Args&&... args) {
+		pair<tree_node*, bool> result = tree_get_or_emplace(nullptr, key, std::piecewise_construct,
+			std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+		return make_pair(iterator(this, result.first), result.second);
+	}
+
+	template <class... Args>
+	pair<iterator, bool> try_emplace(Key &&key, Args&&... args) {
+		pair<tree_node*, bool> result = tree_get_or_emplace(nullptr, key, std::piecewise_construct,
+			std::forward_as_tuple(std::move(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+		return make_pair(iterator(this, result.first), result.second);
+	}
+
+	template <class M>
+	pair<iterator, bool> insert_or_assign(const Key &key, M &&obj) {
+		tree_node *parent;
+		bool from_left;
+		tree_node *p = tree_find_slot(key, parent, from_left);
+		if (p) {
+			value_of(p).second = std::forward<M>(obj);
+			pull_path(p);
+			return make_pair(iterator(this, p), false);
+		}
+		tree_node *new_node = create_node(RED, parent, key, std::forward<M>(obj));
+		tree_link(new_node, parent, from_left);
+		return make_pair(iterator(this, new_node), true);
+	}
+
+	// the iterator after pos.
+	iterator erase(iterator pos) {
 		if (pos.mp_belong != this || pos.ptr == header) 
 			throw invalid_iterator();
+		tree_node *next = pos.ptr;
+		tree_increasment(next);
 		tree_remove(pos.ptr);
+		return iterator(this, next);
+	}
+
+	// one descent, no iterator.
+	size_t erase(const Key &key) {
+		tree_node *p = tree_access(key);
+		if (!p) return 0;
+		tree_remove(p);
+		return 1;
+	}
+	template <class K, class C = Compare, class = typename C::is_transparent,
+		class = typename std::enable_if<!std::is_convertible<const K&, const_iterator>::value>::type>
+	size_t erase(const K &key) {
+		tree_node *p = tree_access(key);
+		if (!p) return 0;
+		tree_remove(p);
+		return 1;
 	}
 
+	// erase [first, last), returning last.
+	iterator erase(const_iterator first, const_iterator last) {
+		if (first.mp_belong != this || last.mp_belong != this || !first.ptr || !last.ptr)
+			throw invalid_iterator();
+		if (first.ptr == header->left && last.ptr == header) {
+			clear();
+			return end();
+		}
+		tree_node *p = first.ptr;
+		while (p != last.ptr) {
+			if (p == header) throw invalid_iterator();
+			tree_node *next = p;
+			tree_increasment(next);
+			tree_remove(p);
+			p = next;
+		}
+		return iterator(this, p);
+	}
+
+	// unlink the element at pos, keeping its node.
+	node_type extract(const_iterator pos) {
+		if (pos.mp_belong != this || !pos.ptr || pos.ptr == header)
+			throw invalid_iterator();
+		return tree_extract(pos.ptr);
+	}
+
+	node_type extract(const Key &key) {
+		tree_node *p = tree_access(key);
+		return p ? tree_extract(p) : node_type();
+	}
+
+	// link the node of nh unless its key is there; then nh is handed back.
+	// with unequal allocators the value is moved into a new node instead.
+	insert_return_type insert(node_type &&nh) {
+		if (nh.empty()) {
+			return insert_return_type{end(), false, node_type()};
+		}
+		tree_node *parent;
+		bool from_left;
+		tree_node *p = tree_find_slot(nh.key(), parent, from_left);
+		if (p) {
+			return insert_return_type{iterator(this, p), false, std::move(nh)};
+		}
+		tree_node *node;
+		if (nh.alloc == alloc) {
+			node = nh.node;
+			nh.node = nullptr;
+		} else {
+			node = create_node(RED, parent, std::move(nh.value()));
+		}
+		tree_link(node, parent, from_left);
+		nh.reset();
+		return insert_return_type{iterator(this, node), true, node_type()};
+	}
+
+	// move the elements of source whose keys are not here yet, relinking
+	// their nodes. with unequal allocators the values are moved instead.
+	void merge(map &source) {
+		if (&source == this || source.empty()) return;
+		bool relink = source.alloc == alloc;
+		tree_node *p = source.header->left;
+		while (p != source.header) {
+			tree_node *next = p;
+			source.tree_increasment(next);
+			tree_node *parent;
+			bool from_left;
+			if (!tree_find_slot(key_of(p), parent, from_left)) {
+				if (relink) {
+					source.tree_unlink(p);
+					tree_link(p, parent, from_left);
+				} else {
+					tree_link(create_node(RED, parent, std::move(value_of(p))), parent, from_left);
+					source.tree_remove(p);
+				}
+			}
+			p = next;
+		}
+	}
+
+	void merge(map &&source) { merge(source); }
+
 	iterator find(const Key &key) {
 		tree_node *tmp = tree_access(key);
 		return iterator(this, tmp ? tmp : header);
@@ -613,8 +2227,307 @@ public:
 		tree_node *tmp = tree_access(key);
 		return const_iterator(this, tmp ? tmp : header);
 	}
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	iterator find(const K &key) {
+		tree_node *tmp = tree_access(key);
+		return iterator(this, tmp ? tmp : header);
+	}
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	const_iterator find(const K &key) const {
+		tree_node *tmp = tree_access(key);
+		return const_iterator(this, tmp ? tmp : header);
+	}
+
+	// out[i] = find(keys[i]) for every i in [0, n), much faster than one
+	// find after another when the tree is larger than the cache. return
+	// the number found.
+	size_t find_batch(const Key *keys, size_t n, iterator *out) {
+		size_t hits = 0;
+		tree_find_batch(keys, n, [this, out, &hits](size_t i, tree_node *p) {
+			out[i] = iterator(this, p);
+			hits += p != header;
+		});
+		return hits;
+	}
+	size_t find_batch(const Key *keys, size_t n, const_iterator *out) const {
+		size_t hits = 0;
+		tree_find_batch(keys, n, [this, out, &hits](size_t i, tree_node *p) {
+			out[i] = const_iterator(this, p);
+			hits += p != header;
+		});
+		return hits;
+	}
+
+	iterator lower_bound(const Key &key) { return iterator(this, tree_lower_bound(key)); }
+	const_iterator lower_bound(const Key &key) const { return const_iterator(this, tree_lower_bound(key)); }
+	iterator upper_bound(const Key &key) { return iterator(this, tree_upper_bound(key)); }
+	const_iterator upper_bound(const Key &key) const { return const_iterator(this, tree_upper_bound(key)); }
+
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	iterator lower_bound(const K &key) { return iterator(this, tree_lower_bound(key)); }
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	const_iterator lower_bound(const K &key) const { return const_iterator(this, tree_lower_bound(key)); }
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	iterator upper_bound(const K &key) { return iterator(this, tree_upper_bound(key)); }
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	const_iterator upper_bound(const K &key) const { return const_iterator(this, tree_upper_bound(key)); }
+
+	pair<iterator, iterator> equal_range(const Key &key) {
+		tree_node *p = tree_lower_bound(key);
+		tree_node *q = p;
+		if (p != header && !key_less(key, key_of(p))) tree_increasment(q);
+		return pair<iterator, iterator>(iterator(this, p), iterator(this, q));
+	}
+	pair<const_iterator, const_iterator> equal_range(const Key &key) const {
+		tree_node *p = tree_lower_bound(key);
+		tree_node *q = p;
+		if (p != header && !key_less(key, key_of(p))) tree_increasment(q);
+		return pair<const_iterator, const_iterator>(const_iterator(this, p), const_iterator(this, q));
+	}
+
+	// a key of another type may match several elements.
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	pair<iterator, iterator> equal_range(const K &key) {
+		return pair<iterator, iterator>(iterator(this, tree_lower_bound(key)), iterator(this, tree_upper_bound(key)));
+	}
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	pair<const_iterator, const_iterator> equal_range(const K &key) const {
+		return pair<const_iterator, const_iterator>(const_iterator(this, tree_lower_bound(key)), const_iterator(this, tree_upper_bound(key)));
+	}
+
+	// the elements with lo <= key < hi. both ends are found by one descent
+	// each; the scan in between only compares node pointers.
+	range_view<iterator> range(const Key &lo, const Key &hi) {
+		tree_node *first = tree_lower_bound(lo);
+		tree_node *last = key_less(lo, hi) ? tree_lower_bound(hi) : first;
+		return range_view<iterator>{iterator(this, first), iterator(this, last)};
+	}
+	range_view<const_iterator> range(const Key &lo, const Key &hi) const {
+		tree_node *first = tree_lower_bound(lo);
+		tree_node *last = key_less(lo, hi) ? tree_lower_bound(hi) : first;
+		return range_view<const_iterator>{const_iterator(this, first), const_iterator(this, last)};
+	}
+
+	// the element with k smaller keys, or end(). needs order_statistics.
+	iterator select(size_t k) { return iterator(this, tree_select(k)); }
+	const_iterator select(size_t k) const { return const_iterator(this, tree_select(k)); }
+
+	// the number of keys less than key. needs order_statistics.
+	size_t rank(const Key &key) const { return tree_rank(key); }
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	size_t rank(const K &key) const { return tree_rank(key); }
+
+	// the position of pos; size() for end(). needs order_statistics.
+	size_t index_of(const const_iterator &pos) const {
+		if (pos.mp_belong != this || !pos.ptr)
+			throw invalid_iterator();
+		return tree_index(pos.ptr);
+	}
+
+	// the number of increments from first to last, in O(log n).
+	ptrdiff_t distance(const const_iterator &first, const const_iterator &last) const {
+		return (ptrdiff_t)index_of(last) - (ptrdiff_t)index_of(first);
+	}
+
+	// the aggregate of the whole map, or of the keys in [lo, hi), in O(log n).
+	aggregate_type aggregate() const {
+		return subtree_agg(header->parent());
+	}
+	aggregate_type aggregate(const Key &lo, const Key &hi) const {
+		return tree_aggregate(lo, hi);
+	}
+	template <class K, class C = Compare, class = typename C::is_transparent>
+	aggregate_type aggregate(const K &lo, const K &hi) const {
+		return tree_aggregate(lo, hi);
+	}
+
+	// call f on the mapped value at pos, then recompute the aggregates
+	// that depend on it.
+	template <class F>
+	void modify(const_iterator pos, F f) {
+		if (pos.mp_belong != this || !pos.ptr || pos.ptr == header)
+			throw invalid_iterator();
+		try {
+			f(value_of(pos.ptr).second);
+		} catch (...) {
+			pull_path(pos.ptr);
+			throw;
+		}
+		pull_path(pos.ptr);
+	}
+
+	// recompute the aggregates that depend on the value at pos, after it
+	// changed in a way the map cannot see, e.g. behind a pointer.
+	void refresh(const_iterator pos) {
+		if (pos.mp_belong != this || !pos.ptr || pos.ptr == header)
+			throw invalid_iterator();
+		pull_path(pos.ptr);
+	}
+
+	// move the elements with keys not less than key into the returned map.
+	// cutting the tree is O(log n). with order_statistics the sizes are
+	// read off the roots; otherwise the smaller part is counted, so that
+	// moving k elements is O(log n + min(k, n - k)) in all.
+	map split(const Key &key) {
+		map right(comp(), alloc);
+		size_t n = tree_size;
+		subtree l, r;
+		tree_node *mid;
+		tree_split(tree_detach(), key, l, mid, r);
+		if (mid) r = tree_join(subtree{nullptr, 0}, mid, r);
+		tree_attach(l, 0);
+		right.tree_attach(r, 0);
+		split_sizes(right, n, Augment());
+		return right;
+	}
+
+	// append the elements of right, whose keys must all be greater, in
+	// O(log n). right is left empty.
+	void join(map &right) {
+		if (&right == this || right.empty()) return;
+		if (!empty() && !key_less(key_of(header->right), key_of(right.header->left)))
+			throw runtime_error();
+		if (!(alloc == right.alloc)) {
+			merge(right);
+			return;
+		}
+		size_t n = tree_size + right.tree_size;
+		subtree r = right.tree_detach();
+		tree_node *first;
+		r = tree_split_first(r, first);
+		tree_attach(tree_join(tree_detach(), first, r), n);
+	}
+
+	// the set operations split one tree by the keys of the other and
+	// recurse on both halves in parallel, then join the results:
+	// O(m log(n / m + 1)) work for sizes m <= n, with the top levels of
+	// the recursion spread over the cores. the comparator must not throw.
+
+	// add the elements of other whose keys are not here, relinking their
+	// nodes. other is left empty.
+	void union_with(map &other) {
+		if (&other == this || other.empty()) return;
+		if (!(alloc == other.alloc)) {
+			merge(other);
+			other.clear();
+			return;
+		}
+		size_t n = tree_size + other.tree_size;
+		set_result res = tree_union(tree_detach(), other.tree_detach(), parallel_depth());
+		tree_attach(res.t, n - res.found);
+		tree_drop(res.drop);
+	}
+
+	void union_with(map &&other) { union_with(other); }
+
+	// keep only the keys also in other.
+	void intersect_with(const map &other) {
+		if (&other == this) return;
+		set_result res = tree_intersect(tree_detach(), other.header->parent(), parallel_depth());
+		tree_attach(res.t, res.found);
+		tree_drop(res.drop);
+	}
+
+	// drop the keys that are in other.
+	void difference_with(const map &other) {
+		if (&other == this) {
+			clear();
+			return;
+		}
+		size_t n = tree_size;
+		set_result res = tree_difference(tree_detach(), other.header->parent(), parallel_depth());
+		tree_attach(res.t, n - res.found);
+		tree_drop(res.drop);
+	}
+
+	map_stats stats() const {
+		map_stats s{};
+#ifdef SJTU_MAP_STATS
+		s.comparisons = counters.comparisons.load(std::memory_order_relaxed);
+		s.rotations_left = counters.rotations_left.load(std::memory_order_relaxed);
+		s.rotations_right = counters.rotations_right.load(std::memory_order_relaxed);
+		s.insert_fixups = counters.insert_fixups.load(std::memory_order_relaxed);
+		s.erase_fixups = counters.erase_fixups.load(std::memory_order_relaxed);
+		s.node_allocations = counters.node_allocations.load(std::memory_order_relaxed);
+		s.node_frees = counters.node_frees.load(std::memory_order_relaxed);
+#endif
+		s.size = tree_size;
+		s.bytes_in_use = tree_size * sizeof(value_node) + sizeof(tree_node);
+		s.bytes_reserved = pool.capacity() * sizeof(value_node) + sizeof(tree_node);
+		return s;
+	}
+
+	void reset_stats() {
+#ifdef SJTU_MAP_STATS
+		counters.comparisons = 0;
+		counters.rotations_left = 0;
+		counters.rotations_right = 0;
+		counters.insert_fixups = 0;
+		counters.erase_fixups = 0;
+		counters.node_allocations = 0;
+		counters.node_frees = 0;
+#endif
+	}
+
+	// walk the whole tree, O(n).
+	map_tree_stats tree_stats() const {
+		map_tree_stats s;
+		s.black_height = tree_shape(header->parent(), 0, s);
+		s.height = s.depth_count.size();
+		return s;
+	}
+
+	// a copy for lookups only, see frozen_map.hpp.
+	frozen_map<Key, T, Compare, Allocator> freeze() const {
+		return frozen_map<Key, T, Compare, Allocator>(*this, get_allocator());
+	}
+
+	// write the elements to os in key order, see save_header for the
+	// layout. keys and values go through serializer (serializer.hpp).
+	// when both are trivially copyable the entries are raw bytes, so the
+	// file only suits machines with the same byte order and type sizes.
+	void save(std::ostream &os) const {
+		save_header(os);
+		save_entries(os, std::integral_constant<bool, packed_io>());
+		if (!os) throw runtime_error();
+	}
+
+	// replace the elements with what save wrote, in O(n): they come in
+	// order, so the tree is built bottom up without a search or a
+	// rebalance. is is left right after the map.
+	// a malformed stream throws runtime_error and leaves the map as it was.
+	void load(std::istream &is) {
+		size_t n = load_header(is);
+		load_entries(is, n, std::integral_constant<bool, packed_io>());
+	}
+
+	void save_file(const char *path) const {
+		std::ofstream os(path, std::ios::binary);
+		if (!os) throw runtime_error();
+		save(os);
+	}
+
+	// load from the file at path. with SJTU_MAP_MMAP a packed file is
+	// mapped instead of read, and the tree is built straight from the
+	// page cache.
+	void load_file(const char *path) {
+		std::ifstream is(path, std::ios::binary);
+		if (!is) throw runtime_error();
+		load_file(path, is, std::integral_constant<bool, packed_io>());
+	}
 };
 
+#ifdef SJTU_HAS_PMR
+namespace pmr {
+	template <class Key, class T, class Compare = std::less<Key>, class Augment = no_augment>
+	using map = sjtu::map<Key, T, Compare, std::pmr::polymorphic_allocator<pair<const Key, T>>, Augment>;
 }
+#endif
+
+}
+
+#undef SJTU_MAP_COUNT
+
+#include "frozen_map.hpp"
 
 #endif
@@ -0,0 +1,46 @@
+#ifndef SJTU_MAPPED_FILE_HPP
+#define SJTU_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "exceptions.hpp"
+
+namespace sjtu {
+
+// a whole file mapped read-only, for map::load_file; POSIX only, so
+// map.hpp includes it only with SJTU_MAP_MMAP defined.
+// a file that cannot be opened or mapped throws runtime_error.
+class mapped_file {
+	void *base;
+	size_t bytes;
+public:
+	explicit mapped_file(const char *path) : base(nullptr), bytes(0) {
+		int fd = ::open(path, O_RDONLY);
+		if (fd < 0) throw runtime_error();
+		struct stat st;
+		if (::fstat(fd, &st) != 0) {
+			::close(fd);
+			throw runtime_error();
+		}
+		bytes = (size_t)st.st_size;
+		if (bytes) base = ::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (base == MAP_FAILED) throw runtime_error();
+		if (bytes) ::madvise(base, bytes, MADV_SEQUENTIAL);
+	}
+	mapped_file(const mapped_file &) = delete;
+	mapped_file & operator=(const mapped_file &) = delete;
+	~mapped_file() {
+		if (bytes) ::munmap(base, bytes);
+	}
+
+	const char* data() const { return static_cast<const char*>(base); }
+	size_t size() const { return bytes; }
+};
+
+}
+
+#endif
@@ -0,0 +1,612 @@
+#ifndef SJTU_PERSISTENT_MAP_HPP
+#define SJTU_PERSISTENT_MAP_HPP
+
+#include <functional>
+#include <cstddef>
+#include <memory>
+#include <atomic>
+#include <utility>
+#include "map.hpp"
+
+namespace sjtu {
+
+// an ordered map whose copies share their nodes: copying, or snapshot(),
+// is O(1), and insert and erase copy only the O(log n) nodes on the path
+// they change. a node is reference counted and freed with the last
+// version that reaches it.
+// the tree is an AVL tree without parent links, so that nodes can be
+// shared by many versions; iterators keep the path from the root.
+// a change never touches a node that is already in a version: it builds
+// the new path aside and then publishes the new root at once. if a copy
+// of a value throws, the map is left as it was.
+// different maps may be used from different threads at the same time,
+// even when they share nodes. one map may have one writer while other
+// threads take snapshot()s or copies of it, and read those; neither side
+// waits for the other. anything else on one map needs the caller to lock.
+template<
+	class Key,
+	class T,
+	class Compare = std::less<Key>,
+	class Allocator = std::allocator<pair<const Key, T>>
+> class persistent_map : private compare_holder<Compare> {
+public:
+	using value_type = pair<const Key, T>;
+	using allocator_type = Allocator;
+	using key_compare = Compare;
+private:
+	using compare_holder<Compare>::comp;
+
+	struct tree_node {
+		std::atomic<size_t> refs;
+		tree_node *left, *right;
+		int height;
+		// made by the change in progress, so no version reaches it yet.
+		bool fresh;
+		value_type value;
+		template <class... Args>
+		tree_node(tree_node *l, tree_node *r, int h, Args&&... args):
+			refs(1), left(l), right(r), height(h), fresh(true), value(std::forward<Args>(args)...) {}
+	};
+
+	// a root and its size, as published to readers; never changed after.
+	struct version {
+		tree_node *root;
+		size_t size;
+		version *next;
+	};
+
+	// a tree of that height has more nodes than can be addressed.
+	static constexpr int max_height = 64;
+
+	using alloc_traits = std::allocator_traits<Allocator>;
+	using node_allocator = typename alloc_traits::template rebind_alloc<tree_node>;
+	using node_traits = std::allocator_traits<node_allocator>;
+	using version_allocator = typename alloc_traits::template rebind_alloc<version>;
+	using version_traits = std::allocator_traits<version_allocator>;
+
+	// the current version, or nullptr when empty.
+	std::atomic<version*> head;
+	// versions replaced while a reader may still be taking them; freed by
+	// the first change that sees no reader.
+	version *retired;
+	// readers between loading head and holding its root.
+	mutable std::atomic<size_t> readers;
+	Allocator alloc;
+
+	template <class... Args>
+	tree_node* create_node(tree_node *l, tree_node *r, int h, Args&&... args) {
+		node_allocator na(alloc);
+		tree_node *p = node_traits::allocate(na, 1);
+		try {
+			node_traits::construct(na, p, l, r, h, std::forward<Args>(args)...);
+		} catch (...) {
+			node_traits::deallocate(na, p, 1);
+			throw;
+		}
+		return p;
+	}
+
+	// free p only; its children are the caller's.
+	void destroy_node(tree_node *p) {
+		node_allocator na(alloc);
+		node_traits::destroy(na, p);
+		node_traits::deallocate(na, p, 1);
+	}
+
+	static tree_node* retain(tree_node *p) {
+		if (p) p->refs.fetch_add(1, std::memory_order_relaxed);
+		return p;
+	}
+
+	// drop one reference to p, freeing what nobody refers to any more.
+	void release(tree_node *p) {
+		while (p && p->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			release(p->left);
+			tree_node *r = p->right;
+			destroy_node(p);
+			p = r;
+		}
+	}
+
+	// unlink a child, so that a failure below leaves its parent whole.
+	static tree_node* detach(tree_node *&link) {
+		tree_node *p = link;
+		link = nullptr;
+		return p;
+	}
+
+	// take over the reference to p and return a node the change may
+	// modify: p itself if the change made it, or a copy. the reference is
+	// dropped if the copy throws.
+	tree_node* writable(tree_node *p) {
+		if (p->fresh) return p;
+		tree_node *q;
+		try {
+			q = create_node(nullptr, nullptr, p->height, p->value);
+		} catch (...) {
+			release(p);
+			throw;
+		}
+		q->left = retain(p->left);
+		q->right = retain(p->right);
+		release(p);
+		return q;
+	}
+
+	// the fresh nodes hang together from the root, since no older node
+	// can point at one.
+	static void settle(tree_node *p) {
+		while (p && p->fresh) {
+			p->fresh = false;
+			settle(p->left);
+			p = p->right;
+		}
+	}
+
+	tree_node* top() const {
+		version *v = head.load(std::memory_order_relaxed);
+		return v ? v->root : nullptr;
+	}
+
+	size_t top_size() const {
+		version *v = head.load(std::memory_order_relaxed);
+		return v ? v->size : 0;
+	}
+
+	// the current root and size, holding a reference to the root. safe
+	// against the writer: a version is not freed while a reader is here.
+	version current() const {
+		readers.fetch_add(1, std::memory_order_seq_cst);
+		version *v = head.load(std::memory_order_seq_cst);
+		version got{v ? retain(v->root) : nullptr, v ? v->size : 0, nullptr};
+		readers.fetch_sub(1, std::memory_order_release);
+		return got;
+	}
+
+	// make v the current version. the old one goes to retired, and
+	// retired is freed if no reader can be taking any of it.
+	void install(version *v) {
+		version *old = head.exchange(v, std::memory_order_seq_cst);
+		if (old) {
+			old->next = retired;
+			retired = old;
+		}
+		if (!readers.load(std::memory_order_seq_cst)) reclaim();
+	}
+
+	void reclaim() {
+		while (retired) {
+			version *r = retired;
+			retired = r->next;
+			release(r->root);
+			version_allocator va(alloc);
+			version_traits::deallocate(va, r, 1);
+		}
+	}
+
+	// make root, of n elements, the current version, taking over the
+	// reference to it. on failure root is released and nothing changes.
+	void publish(tree_node *root, size_t n) {
+		version *v = nullptr;
+		if (root) {
+			version_allocator va(alloc);
+			try {
+				v = version_traits::allocate(va, 1);
+			} catch (...) {
+				release(root);
+				throw;
+			}
+			settle(root);
+			v->root = root;
+			v->size = n;
+			v->next = nullptr;
+		}
+		install(v);
+	}
+
+	static int height_of(tree_node *p) { return p ? p->height : 0; }
+
+	static void update(tree_node *p) {
+		int l = height_of(p->left), r = height_of(p->right);
+		p->height = (l > r ? l : r) + 1;
+	}
+
+	// p is writable. if the copy throws, p is left whole, short of the
+	// child that would have moved.
+	tree_node* rot_right(tree_node *p) {
+		tree_node *l = writable(detach(p->left));
+		p->left = l->right;
+		l->right = p;
+		update(p);
+		update(l);
+		return l;
+	}
+
+	tree_node* rot_left(tree_node *p) {
+		tree_node *r = writable(detach(p->right));
+		p->right = r->left;
+		r->left = p;
+		update(p);
+		update(r);
+		return r;
+	}
+
+	// p is writable and its children are balanced.
+	tree_node* balance(tree_node *p) {
+		update(p);
+		int d = height_of(p->left) - height_of(p->right);
+		if (d > 1) {
+			if (height_of(p->left->left) < height_of(p->left->right)) {
+				p->left = writable(detach(p->left));
+				p->left = rot_left(p->left);
+			}
+			return rot_right(p);
+		}
+		if (d < -1) {
+			if (height_of(p->right->right) < height_of(p->right->left)) {
+				p->right = writable(detach(p->right));
+				p->right = rot_right(p->right);
+			}
+			return rot_left(p);
+		}
+		return p;
+	}
+
+	template <class K>
+	tree_node* tree_find(tree_node *p, const K &key) const {
+		while (p) {
+			if (comp()(key, p->value.first))
+				p = p->left;
+			else if (comp()(p->value.first, key))
+				p = p->right;
+			else
+				return p;
+		}
+		return nullptr;
+	}
+
+	// the tree_ changes below take over the reference to p and return the
+	// new subtree. if one throws, what it made is released along with the
+	// reference, and no older node has been touched.
+
+	// insert a node built from args, whose key is not in p.
+	template <class... Args>
+	tree_node* tree_insert(tree_node *p, const Key &key, Args&&... args) {
+		if (!p) return create_node(nullptr, nullptr, 1, std::forward<Args>(args)...);
+		p = writable(p);
+		try {
+			if (comp()(key, p->value.first))
+				p->left = tree_insert(detach(p->left), key, std::forward<Args>(args)...);
+			else
+				p->right = tree_insert(detach(p->right), key, std::forward<Args>(args)...);
+			return balance(p);
+		} catch (...) {
+			release(p);
+			throw;
+		}
+	}
+
+	// make the path to key, which is in p, writable; the node of key is
+	// left in found.
+	tree_node* tree_own(tree_node *p, const Key &key, tree_node *&found) {
+		p = writable(p);
+		try {
+			if (comp()(key, p->value.first))
+				p->left = tree_own(detach(p->left), key, found);
+			else if (comp()(p->value.first, key))
+				p->right = tree_own(detach(p->right), key, found);
+			else
+				found = p;
+		} catch (...) {
+			release(p);
+			throw;
+		}
+		return p;
+	}
+
+	// cut the least node of p out into min. min is set before anything
+	// can throw above it, and is the caller's to release then.
+	tree_node* tree_erase_min(tree_node *p, tree_node *&min) {
+		p = writable(p);
+		if (!p->left) {
+			min = p;
+			return detach(p->right);
+		}
+		try {
+			p->left = tree_erase_min(detach(p->left), min);
+			return balance(p);
+		} catch (...) {
+			release(p);
+			throw;
+		}
+	}
+
+	// erase key, which is in p.
+	tree_node* tree_erase(tree_node *p, const Key &key) {
+		if (comp()(key, p->value.first) || comp()(p->value.first, key)) {
+			p = writable(p);
+			try {
+				if (comp()(key, p->value.first))
+					p->left = tree_erase(detach(p->left), key);
+				else
+					p->right = tree_erase(detach(p->right), key);
+				return balance(p);
+			} catch (...) {
+				release(p);
+				throw;
+			}
+		}
+		tree_node *l, *r;
+		if (p->fresh) {
+			l = detach(p->left);
+			r = detach(p->right);
+		} else {
+			l = retain(p->left);
+			r = retain(p->right);
+		}
+		release(p);
+		if (!l) return r;
+		if (!r) return l;
+		tree_node *min = nullptr;
+		try {
+			r = tree_erase_min(r, min);
+		} catch (...) {
+			release(l);
+			release(min);
+			throw;
+		}
+		min->left = l;
+		min->right = r;
+		try {
+			return balance(min);
+		} catch (...) {
+			release(min);
+			throw;
+		}
+	}
+
+public:
+	class const_iterator {
+		friend class persistent_map;
+		const persistent_map *mp_belong;
+		// the path from the root to the element; empty at end().
+		tree_node *path[max_height];
+		int depth;
+
+		void push_left(tree_node *p) {
+			for (; p; p = p->left) path[depth++] = p;
+		}
+		void push_right(tree_node *p) {
+			for (; p; p = p->right) path[depth++] = p;
+		}
+		tree_node* node() const { return depth ? path[depth - 1] : nullptr; }
+	public:
+		const_iterator() : mp_belong(nullptr), depth(0) {}
+		const_iterator(const const_iterator &other) : mp_belong(other.mp_belong), depth(other.depth) {
+			for (int i = 0; i < depth; ++i) path[i] = other.path[i];
+		}
+		const_iterator & operator=(const const_iterator &other) {
+			mp_belong = other.mp_belong;
+			depth = other.depth;
+			for (int i = 0; i < depth; ++i) path[i] = other.path[i];
+			return *this;
+		}
+
+		const_iterator & operator++() {
+			if (!mp_belong || !depth) throw invalid_iterator();
+			tree_node *p = path[depth - 1];
+			if (p->right) {
+				push_left(p->right);
+			} else {
+				--depth;
+				while (depth && path[depth - 1]->right == p) {
+					p = path[--depth];
+				}
+			}
+			return *this;
+		}
+		const_iterator operator++(int) {
+			const_iterator tmp = *this;
+			++*this;
+			return tmp;
+		}
+
+		const_iterator & operator--() {
+			if (!mp_belong) throw invalid_iterator();
+			if (!depth) {
+				if (!mp_belong->top()) throw invalid_iterator();
+				push_right(mp_belong->top());
+				return *this;
+			}
+			tree_node *p = path[depth - 1];
+			if (p->left) {
+				push_right(p->left);
+				return *this;
+			}
+			int d = depth - 1;
+			while (d && path[d - 1]->left == p) {
+				p = path[--d];
+			}
+			if (!d) throw invalid_iterator();
+			depth = d;
+			return *this;
+		}
+		const_iterator operator--(int) {
+			const_iterator tmp = *this;
+			--*this;
+			return tmp;
+		}
+
+		const value_type & operator*() const { return node()->value; }
+		const value_type * operator->() const noexcept { return &node()->value; }
+
+		bool operator==(const const_iterator &rhs) const {
+			return mp_belong == rhs.mp_belong && node() == rhs.node();
+		}
+		bool operator!=(const const_iterator &rhs) const { return !(*this == rhs); }
+	};
+	using iterator = const_iterator;
+
+private:
+	template <class K>
+	const_iterator tree_lower_bound(const K &key) const {
+		const_iterator it;
+		it.mp_belong = this;
+		int keep = 0;
+		for (tree_node *p = top(); p; ) {
+			it.path[it.depth++] = p;
+			if (comp()(p->value.first, key)) {
+				p = p->right;
+			} else {
+				keep = it.depth;
+				p = p->left;
+			}
+		}
+		it.depth = keep;
+		return it;
+	}
+
+public:
+	persistent_map() : persistent_map(Compare()) {}
+
+	explicit persistent_map(const Compare &c, const Allocator &a = Allocator()) :
+		compare_holder<Compare>(c), head(nullptr), retired(nullptr), readers(0), alloc(a) {}
+
+	template <class InputIt>
+	persistent_map(InputIt first, InputIt last, const Compare &c = Compare(), const Allocator &a = Allocator()) :
+		persistent_map(c, a) {
+		for (; first != last; ++first) insert(*first);
+	}
+
+	// shares the nodes of other: O(1).
+	persistent_map(const persistent_map &other) : persistent_map(other.comp(), other.alloc) {
+		version got = other.current();
+		publish(got.root, got.size);
+	}
+
+	persistent_map(persistent_map &&other) : persistent_map(other.comp(), other.alloc) {
+		install(other.head.exchange(nullptr));
+	}
+
+	persistent_map & operator=(const persistent_map &other) {
+		if (this != &other) {
+			version got = other.current();
+			publish(got.root, got.size);
+			comp() = other.comp();
+		}
+		return *this;
+	}
+
+	persistent_map & operator=(persistent_map &&other) {
+		if (this != &other) {
+			install(other.head.exchange(nullptr));
+			comp() = other.comp();
+		}
+		return *this;
+	}
+
+	~persistent_map() {
+		install(nullptr);
+		reclaim();
+	}
+
+	// the current version, unaffected by later changes to this map. safe
+	// to call while another thread changes the map, and lock-free.
+	persistent_map snapshot() const { return *this; }
+
+	const T & at(const Key &key) const {
+		tree_node *p = tree_find(top(), key);
+		if (p) return p->value.second;
+		throw index_out_of_bound();
+	}
+
+	const T * try_at(const Key &key) const {
+		tree_node *p = tree_find(top(), key);
+		return p ? &p->value.second : nullptr;
+	}
+
+	// copies the path to key first. the reference is good until the next
+	// change or copy of this map, so a map that is snapshot by other
+	// threads should be changed through insert_or_assign() instead.
+	T & operator[](const Key &key) {
+		tree_node *found;
+		if (tree_find(top(), key)) {
+			publish(tree_own(retain(top()), key, found), top_size());
+		} else {
+			tree_node *root = tree_insert(retain(top()), key, key, T());
+			found = tree_find(root, key);
+			publish(root, top_size() + 1);
+		}
+		return found->value.second;
+	}
+
+	const T & operator[](const Key &key) const { return at(key); }
+
+	const_iterator begin() const { return cbegin(); }
+	const_iterator cbegin() const {
+		const_iterator it;
+		it.mp_belong = this;
+		it.push_left(top());
+		return it;
+	}
+	const_iterator end() const { return cend(); }
+	const_iterator cend() const {
+		const_iterator it;
+		it.mp_belong = this;
+		return it;
+	}
+
+	allocator_type get_allocator() const { return alloc; }
+	key_compare key_comp() const { return comp(); }
+
+	bool empty() const { return top() == nullptr; }
+	size_t size() const { return top_size(); }
+	size_t count(const Key &key) const { return tree_find(top(), key) ? 1 : 0; }
+
+	void clear() {
+		install(nullptr);
+	}
+
+	pair<const_iterator, bool> insert(const value_type &value) {
+		if (tree_find(top(), value.first)) return pair<const_iterator, bool>(find(value.first), false);
+		publish(tree_insert(retain(top()), value.first, value), top_size() + 1);
+		return pair<const_iterator, bool>(find(value.first), true);
+	}
+
+	template <class M>
+	pair<const_iterator, bool> insert_or_assign(const Key &key, M &&obj) {
+		bool inserted = !tree_find(top(), key);
+		if (inserted) {
+			publish(tree_insert(retain(top()), key, key, std::forward<M>(obj)), top_size() + 1);
+		} else {
+			tree_node *found;
+			tree_node *root = tree_own(retain(top()), key, found);
+			try {
+				found->value.second = std::forward<M>(obj);
+			} catch (...) {
+				release(root);
+				throw;
+			}
+			publish(root, top_size());
+		}
+		return pair<const_iterator, bool>(find(key), inserted);
+	}
+
+	size_t erase(const Key &key) {
+		if (!tree_find(top(), key)) return 0;
+		publish(tree_erase(retain(top()), key), top_size() - 1);
+		return 1;
+	}
+
+	const_iterator find(const Key &key) const {
+		const_iterator it = tree_lower_bound(key);
+		if (it.depth && comp()(key, it.node()->value.first)) return cend();
+		return it;
+	}
+
+	const_iterator lower_bound(const Key &key) const { return tree_lower_bound(key); }
+};
+
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef SJTU_SERIALIZER_HPP
+#define SJTU_SERIALIZER_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include "exceptions.hpp"
+
+namespace sjtu {
+
+// unsigned LEB128: 7 bits a byte, low bits first, the high bit set on all
+// but the last byte.
+inline void write_varint(std::ostream &os, unsigned long long x) {
+	char buf[10];
+	size_t n = 0;
+	while (x >= 0x80) {
+		buf[n++] = (char)((x & 0x7f) | 0x80);
+		x >>= 7;
+	}
+	buf[n++] = (char)x;
+	os.write(buf, n);
+}
+
+inline unsigned long long read_varint(std::istream &is) {
+	unsigned long long x = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		int c = is.get();
+		if (c == std::char_traits<char>::eof()) throw runtime_error();
+		x |= (unsigned long long)(c & 0x7f) << shift;
+		if (!(c & 0x80)) return x;
+	}
+	throw runtime_error();
+}
+
+// how map::save and map::load encode a key or a value; a missing or
+// short read throws runtime_error.
+// trivially copyable types are their bytes, in native byte order, and
+// also pack into and unpack from memory. strings are their length, then
+// their characters. specialize this for other types.
+template <class T, class = void>
+struct serializer;
+
+template <class T>
+struct serializer<T, typename std::enable_if<std::is_trivially_copyable<T>::value>::type> {
+	static void write(std::ostream &os, const T &x) {
+		os.write(reinterpret_cast<const char*>(&x), sizeof(T));
+	}
+	static T read(std::istream &is) {
+		T x;
+		if (!is.read(reinterpret_cast<char*>(&x), sizeof(T))) throw runtime_error();
+		return x;
+	}
+	static void pack(char *p, const T &x) { std::memcpy(p, &x, sizeof(T)); }
+	static T unpack(const char *p) {
+		T x;
+		std::memcpy(&x, p, sizeof(T));
+		return x;
+	}
+};
+
+template <class C, class Traits, class Alloc>
+struct serializer<std::basic_string<C, Traits, Alloc>> {
+	using string_type = std::basic_string<C, Traits, Alloc>;
+	static void write(std::ostream &os, const string_type &s) {
+		write_varint(os, s.size());
+		os.write(reinterpret_cast<const char*>(s.data()), s.size() * sizeof(C));
+	}
+	// grown a piece at a time, so that a corrupt length fails on the
+	// read instead of allocating it.
+	static string_type read(std::istream &is) {
+		unsigned long long n = read_varint(is);
+		string_type s;
+		while (s.size() < n) {
+			size_t have = s.size(), step = n - have < 4096 ? (size_t)(n - have) : 4096;
+			s.resize(have + step);
+			if (!is.read(reinterpret_cast<char*>(&s[have]), step * sizeof(C))) throw runtime_error();
+		}
+		return s;
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,99 @@
+// the aggregates of an augmented map follow every write to it.
+//   g++ -std=c++17 -O2 -I.. -I../../deque augment_test.cpp -o augment_test
+//   ./augment_test
+#include "map.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <string>
+#include <type_traits>
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		exit(1); \
+	} \
+} while (0)
+
+struct sum_mapped {
+	using value_type = long long;
+	static long long identity() { return 0; }
+	static long long combine(long long a, long long b) { return a + b; }
+	template <class V>
+	static long long lift(const V &v) { return v.second; }
+};
+
+struct count_odd_keys {
+	static constexpr bool reads_mapped = false;
+	using value_type = size_t;
+	static size_t identity() { return 0; }
+	static size_t combine(size_t a, size_t b) { return a + b; }
+	template <class V>
+	static size_t lift(const V &v) { return v.first % 2 != 0; }
+};
+
+template <class Augment>
+using test_map = sjtu::map<int, int, std::less<int>, std::allocator<sjtu::pair<const int, int>>, Augment>;
+
+template <class M>
+using mapped_of_index = decltype(std::declval<M &>()[0]);
+template <class M>
+using element_of_iterator = decltype(*std::declval<M &>().begin());
+
+// a mapped value the aggregates read cannot be written behind their back.
+static_assert(!std::is_assignable<mapped_of_index<test_map<sum_mapped>>, int>::value, "operator[] is read-only");
+static_assert(std::is_const<std::remove_reference<decltype(std::declval<test_map<sum_mapped> &>().at(0))>::type>::value,
+	"at() is read-only");
+static_assert(std::is_const<std::remove_reference<element_of_iterator<test_map<sum_mapped>>>::type>::value,
+	"iterators are read-only");
+// one that they do not read stays writable.
+static_assert(std::is_assignable<mapped_of_index<test_map<count_odd_keys>>, int>::value, "operator[] is writable");
+static_assert(std::is_assignable<mapped_of_index<test_map<sjtu::order_statistics>>, int>::value, "operator[] is writable");
+static_assert(std::is_assignable<mapped_of_index<sjtu::map<int, int>>, int>::value, "operator[] is writable");
+
+int main() {
+	std::mt19937 rng(1);
+	test_map<sum_mapped> m;
+	std::map<int, int> ref;
+	for (int i = 0; i < 20000; ++i) {
+		int k = (int)(rng() % 1000), v = (int)(rng() % 100);
+		switch (rng() % 4) {
+		case 0:
+			m.insert_or_assign(k, v);
+			ref[k] = v;
+			break;
+		case 1:
+			m[k];
+			ref[k];
+			break;
+		case 2: {
+			test_map<sum_mapped>::iterator it = m.find(k);
+			if (it != m.end()) {
+				m.modify(it, [v](int &x) { x += v; });
+				ref[k] += v;
+			}
+			break;
+		}
+		default: {
+			test_map<sum_mapped>::iterator it = m.find(k);
+			if (it != m.end()) m.erase(it);
+			ref.erase(k);
+		}
+		}
+		int lo = (int)(rng() % 1000), hi = (int)(rng() % 1000);
+		long long want = 0;
+		if (lo < hi) {
+			for (auto it = ref.lower_bound(lo); it != ref.end() && it->first < hi; ++it) want += it->second;
+		}
+		CHECK(m.aggregate(lo, hi) == want);
+	}
+
+	test_map<count_odd_keys> odd;
+	for (int i = 0; i < 100; ++i) odd[i] = i;
+	for (int i = 0; i < 100; ++i) odd[i] = -i;
+	CHECK(odd.aggregate() == 50);
+	CHECK(odd.aggregate(10, 20) == 5);
+	printf("ok\n");
+	return 0;
+}
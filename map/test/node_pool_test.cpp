@@ -0,0 +1,127 @@
+// memory of maps whose nodes move between them stays bounded.
+//   g++ -std=c++17 -O2 -pthread -I.. -I../../deque node_pool_test.cpp -o node_pool_test
+//   ./node_pool_test
+#include "map.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		exit(1); \
+	} \
+} while (0)
+
+static std::atomic<size_t> live_bytes(0);
+
+template <class T>
+struct counting_allocator {
+	using value_type = T;
+	counting_allocator() = default;
+	template <class U>
+	counting_allocator(const counting_allocator<U> &) {}
+	T * allocate(size_t n) {
+		live_bytes += n * sizeof(T);
+		return std::allocator<T>().allocate(n);
+	}
+	void deallocate(T *p, size_t n) {
+		live_bytes -= n * sizeof(T);
+		std::allocator<T>().deallocate(p, n);
+	}
+	template <class U>
+	bool operator==(const counting_allocator<U> &) const { return true; }
+	template <class U>
+	bool operator!=(const counting_allocator<U> &) const { return false; }
+};
+
+using test_map = sjtu::map<int, int, std::less<int>, counting_allocator<sjtu::pair<const int, int>>>;
+
+static test_map random_map(std::mt19937 &rng, size_t n) {
+	test_map m;
+	while (m.size() < n) m[(int)(rng() % 1000000)] = 1;
+	return m;
+}
+
+// erase random elements down to n.
+static void trim(test_map &m, std::mt19937 &rng, size_t n) {
+	while (m.size() > n) {
+		test_map::iterator it = m.lower_bound((int)(rng() % 1000000));
+		if (it == m.end()) it = m.begin();
+		m.erase(it);
+	}
+}
+
+// merge a new map into a long-lived one each round and trim it back.
+static void repeated_merge() {
+	std::mt19937 rng(1);
+	test_map l;
+	size_t settled = 0;
+	for (int round = 0; round < 200; ++round) {
+		{
+			test_map tmp = random_map(rng, 20000);
+			l.merge(tmp);
+		}
+		trim(l, rng, 1000);
+		if (round == 20) settled = live_bytes;
+		if (round > 20) CHECK(live_bytes <= 2 * settled);
+	}
+	CHECK(l.size() == 1000);
+	l.clear();
+}
+
+// take one node out of each new map into a long-lived one.
+static void repeated_extract() {
+	std::mt19937 rng(2);
+	test_map l;
+	for (int round = 0; round < 200; ++round) {
+		test_map tmp = random_map(rng, 20000);
+		l.insert(tmp.extract(tmp.begin()));
+	}
+	// a node keeps at most one chunk of its old map, 16 pages of 1 KiB here.
+	CHECK(live_bytes <= l.size() * 20 * 1024 + 64 * 1024);
+}
+
+// split, join and the set operations relink nodes too.
+static void repeated_split() {
+	std::mt19937 rng(3);
+	test_map l = random_map(rng, 1000);
+	for (int round = 0; round < 200; ++round) {
+		test_map tmp = random_map(rng, 20000);
+		test_map right = tmp.split((int)(rng() % 1000000));
+		l.union_with(right);
+		trim(l, rng, 1000);
+	}
+	CHECK(live_bytes <= 1000 * 20 * 1024 + 64 * 1024);
+}
+
+// nodes freed in another thread go back to their map, which keeps
+// inserting meanwhile.
+static void freed_elsewhere() {
+	test_map m;
+	std::vector<test_map::node_type> handles;
+	for (int i = 0; i < 100000; ++i) m[i] = i;
+	for (int i = 0; i < 50000; ++i) handles.push_back(m.extract(i));
+	std::thread t([&handles] { handles.clear(); });
+	for (int i = 100000; i < 110000; ++i) m[i] = i;
+	t.join();
+	size_t before = live_bytes;
+	for (int i = 110000; i < 150000; ++i) m[i] = i;
+	CHECK(live_bytes == before);
+	CHECK(m.size() == 100000);
+}
+
+int main() {
+	repeated_merge();
+	repeated_extract();
+	repeated_split();
+	CHECK(live_bytes == 0);
+	freed_elsewhere();
+	CHECK(live_bytes == 0);
+	printf("ok\n");
+	return 0;
+}
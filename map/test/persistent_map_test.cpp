@@ -0,0 +1,128 @@
+// readers take snapshots of a persistent_map while one writer changes it.
+//   g++ -std=c++17 -O2 -pthread -I.. -I../../deque persistent_map_test.cpp -o persistent_map_test
+//   ./persistent_map_test
+#include "persistent_map.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		exit(1); \
+	} \
+} while (0)
+
+// a value whose copy throws once copies_left runs out.
+static int copies_left = -1;
+struct bomb {
+	int v;
+	bomb(int v) : v(v) {}
+	bomb(const bomb &other) : v(other.v) {
+		if (copies_left >= 0 && copies_left-- == 0) throw 0;
+	}
+	bomb & operator=(const bomb &other) {
+		if (copies_left >= 0 && copies_left-- == 0) throw 0;
+		v = other.v;
+		return *this;
+	}
+};
+
+// a change whose copy throws leaves the map and its snapshots as they were.
+static void test_throwing_copy() {
+	sjtu::persistent_map<int, bomb> m;
+	std::map<int, int> want;
+	for (int k = 0; k < 100; ++k) {
+		m.insert(sjtu::pair<const int, bomb>(k, bomb(k)));
+		want[k] = k;
+	}
+	sjtu::persistent_map<int, bomb> s = m.snapshot();
+	auto same = [&](const sjtu::persistent_map<int, bomb> &x) {
+		CHECK(x.size() == want.size());
+		auto w = want.begin();
+		for (auto it = x.begin(); it != x.end(); ++it, ++w) {
+			CHECK(it->first == w->first);
+			CHECK(it->second.v == w->second);
+		}
+	};
+
+	std::map<int, int> kept = want;
+	std::mt19937 rng(2);
+	for (int i = 0; i < 20000; ++i) {
+		int k = (int)(rng() % 200);
+		int op = (int)(rng() % 3);
+		copies_left = (int)(rng() % 12);
+		try {
+			if (op == 0) {
+				m.insert(sjtu::pair<const int, bomb>(k, bomb(-k)));
+				want.insert(std::make_pair(k, -k));
+			} else if (op == 1) {
+				m.insert_or_assign(k, bomb(i));
+				want[k] = i;
+			} else {
+				m.erase(k);
+				want.erase(k);
+			}
+		} catch (int) {
+		}
+		copies_left = -1;
+		same(m);
+		if (i == 100) {
+			s = m.snapshot();
+			kept = want;
+		}
+	}
+	want = kept;
+	same(s);
+}
+
+int main() {
+	test_throwing_copy();
+
+	sjtu::persistent_map<int, int> m;
+	std::atomic<bool> done(false);
+	std::atomic<size_t> snapshots(0);
+
+	// every version has value == 2 * key and keys in order.
+	auto read = [&] {
+		while (!done) {
+			sjtu::persistent_map<int, int> s = m.snapshot();
+			size_t n = 0;
+			int last = -1;
+			for (auto it = s.begin(); it != s.end(); ++it) {
+				CHECK(it->first > last);
+				CHECK(it->second == 2 * it->first);
+				last = it->first;
+				++n;
+			}
+			CHECK(n == s.size());
+			++snapshots;
+		}
+	};
+	std::vector<std::thread> readers;
+	for (int i = 0; i < 3; ++i) readers.emplace_back(read);
+
+	std::mt19937 rng(1);
+	for (int i = 0; i < 200000; ++i) {
+		int k = (int)(rng() % 2000);
+		switch (rng() % 3) {
+		case 0:
+			m.insert(sjtu::pair<const int, int>(k, 2 * k));
+			break;
+		case 1:
+			m.insert_or_assign(k, 2 * k);
+			break;
+		default:
+			m.erase(k);
+		}
+	}
+	done = true;
+	for (std::thread &t : readers) t.join();
+	CHECK(snapshots > 0);
+	printf("ok\n");
+	return 0;
+}